@@ -91,4 +91,15 @@ project "test"
             "tcmalloc",
         }
     end
+
+project "replay"
+    kind "ConsoleApp"
+    targetname "replay"
+    dependson { "PhysxWrap" }
+    includedirs {
+        "../src/physx_wrap/",
+    }
+    files {
+        "../src/replay/*.cpp",
+    }
     
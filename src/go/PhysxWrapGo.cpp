@@ -1,10 +1,65 @@
 #include "PhysxWrapGo.h"
 #include "../physx_wrap/PhysxWrap.h"
+#include <cstring>
 
 #ifdef _MSC_VER
 #pragma comment(lib, "PhysxWrap.lib")
 #endif
 
+static void writeRaycastHit(const PhysxWrap::RaycastHit &hit, void *outId, void *outPostion, void *outNormal, void *outDistance) {
+    *(UINT64*)outId = hit.Id;
+    ((float*)outPostion)[0] = hit.Postion.X;
+    ((float*)outPostion)[1] = hit.Postion.Y;
+    ((float*)outPostion)[2] = hit.Postion.Z;
+    ((float*)outNormal)[0] = hit.Normal.X;
+    ((float*)outNormal)[1] = hit.Normal.Y;
+    ((float*)outNormal)[2] = hit.Normal.Z;
+    *(float*)outDistance = hit.Distance;
+}
+
+static std::vector<uint8_t> toBytes(const void *data, int size) {
+    if (data == nullptr || size <= 0) {
+        return std::vector<uint8_t>();
+    }
+    return std::vector<uint8_t>((const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+static int copyOut(const std::vector<uint8_t> &bytes, void *out, int capacity) {
+    if (out != nullptr && int(bytes.size()) <= capacity) {
+        memcpy(out, bytes.data(), bytes.size());
+    }
+    return int(bytes.size());
+}
+
+static PhysxWrap::SceneConfig toSceneConfig(const SceneConfigC &c) {
+    PhysxWrap::SceneConfig config;
+    config.Gravity = PhysxWrap::Vector3{ c.GravityX, c.GravityY, c.GravityZ };
+    config.EnablePCM = c.EnablePCM != 0;
+    config.EnableStabilization = c.EnableStabilization != 0;
+    config.SuppressEagerRefit = c.SuppressEagerRefit != 0;
+    config.EnableCCD = c.EnableCCD != 0;
+    config.FrictionType = c.FrictionType;
+    config.BounceThreshold = c.BounceThreshold;
+    config.SolverPositionIterations = c.SolverPositionIterations;
+    config.SolverVelocityIterations = c.SolverVelocityIterations;
+    config.SleepThreshold = c.SleepThreshold;
+    config.BroadPhase = c.BroadPhase;
+    config.RegionSubdivisions = c.RegionSubdivisions;
+    config.WorldMin = PhysxWrap::Vector3{ c.WorldMinX, c.WorldMinY, c.WorldMinZ };
+    config.WorldMax = PhysxWrap::Vector3{ c.WorldMaxX, c.WorldMaxY, c.WorldMaxZ };
+    config.ThreadCount = c.ThreadCount;
+    config.ScratchSize = c.ScratchSize;
+    config.MaxActors = c.MaxActors;
+    config.MaxBodies = c.MaxBodies;
+    config.MaxStaticShapes = c.MaxStaticShapes;
+    config.MaxDynamicShapes = c.MaxDynamicShapes;
+    config.ThreadSafe = c.ThreadSafe != 0;
+    config.QueryOnly = c.QueryOnly != 0;
+    config.DynamicTreeRebuildRate = c.DynamicTreeRebuildRate;
+    config.EnhancedDeterminism = c.EnhancedDeterminism != 0;
+    return config;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,6 +83,103 @@ extern "C" {
         return nullptr;
     }
 
+    DLLIMPORT void GetDefaultSceneConfig(SceneConfigC *config) {
+        PhysxWrap::SceneConfig d;
+        config->GravityX = d.Gravity.X;
+        config->GravityY = d.Gravity.Y;
+        config->GravityZ = d.Gravity.Z;
+        config->EnablePCM = d.EnablePCM ? 1 : 0;
+        config->EnableStabilization = d.EnableStabilization ? 1 : 0;
+        config->SuppressEagerRefit = d.SuppressEagerRefit ? 1 : 0;
+        config->EnableCCD = d.EnableCCD ? 1 : 0;
+        config->FrictionType = d.FrictionType;
+        config->BounceThreshold = d.BounceThreshold;
+        config->SolverPositionIterations = d.SolverPositionIterations;
+        config->SolverVelocityIterations = d.SolverVelocityIterations;
+        config->SleepThreshold = d.SleepThreshold;
+        config->BroadPhase = d.BroadPhase;
+        config->RegionSubdivisions = d.RegionSubdivisions;
+        config->WorldMinX = d.WorldMin.X;
+        config->WorldMinY = d.WorldMin.Y;
+        config->WorldMinZ = d.WorldMin.Z;
+        config->WorldMaxX = d.WorldMax.X;
+        config->WorldMaxY = d.WorldMax.Y;
+        config->WorldMaxZ = d.WorldMax.Z;
+        config->ThreadCount = d.ThreadCount;
+        config->ScratchSize = d.ScratchSize;
+        config->MaxActors = d.MaxActors;
+        config->MaxBodies = d.MaxBodies;
+        config->MaxStaticShapes = d.MaxStaticShapes;
+        config->MaxDynamicShapes = d.MaxDynamicShapes;
+        config->ThreadSafe = d.ThreadSafe ? 1 : 0;
+        config->QueryOnly = d.QueryOnly ? 1 : 0;
+        config->DynamicTreeRebuildRate = d.DynamicTreeRebuildRate;
+        config->EnhancedDeterminism = d.EnhancedDeterminism ? 1 : 0;
+    }
+
+    DLLIMPORT void* CreateSceneEx(const char *path, const SceneConfigC *config) {
+        auto s = new PhysxWrap::PhysxScene();
+        if (s && s->Init(config ? toSceneConfig(*config) : PhysxWrap::SceneConfig())) {
+            s->CreateScene(path);
+            return (void *)s;
+        }
+
+        if (s) delete s;
+        return nullptr;
+    }
+
+    DLLIMPORT void* CreateSceneRecorded(const char *path, const SceneConfigC *config, const char *logPath) {
+        auto s = new PhysxWrap::PhysxScene();
+        if (s && s->Init(config ? toSceneConfig(*config) : PhysxWrap::SceneConfig())) {
+            s->StartRecording(logPath);
+            s->CreateScene(path);
+            return (void *)s;
+        }
+
+        if (s) delete s;
+        return nullptr;
+    }
+
+    DLLIMPORT void StopRecording(void *scene) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->StopRecording();
+    }
+
+    DLLIMPORT int ReplayRecording(const char *logPath, unsigned threadCount, float *outUpdateMs, int capacity, UINT64 *outStateHash) {
+        std::vector<float> updateMs;
+        uint64_t stateHash = 0;
+        if (!PhysxWrap::ReplayRecording(logPath, threadCount, updateMs, stateHash)) {
+            return -1;
+        }
+        for (size_t i = 0; i < updateMs.size() && int(i) < capacity; i++) {
+            outUpdateMs[i] = updateMs[i];
+        }
+        if (outStateHash != nullptr) {
+            *outStateHash = stateHash;
+        }
+        return int(updateMs.size());
+    }
+
+    DLLIMPORT void PreloadSceneInfo(const char *path) {
+        PhysxWrap::PreloadSceneInfo(path);
+    }
+
+    DLLIMPORT void* CreateSceneAsync(const char *path, const SceneConfigC *config) {
+        auto request = new std::future<PhysxWrap::PhysxScene*>();
+        *request = PhysxWrap::PhysxScene::CreateSceneAsync(path, config ? toSceneConfig(*config) : PhysxWrap::SceneConfig());
+        return request;
+    }
+
+    DLLIMPORT int PollSceneAsync(void *request, void **outScene) {
+        auto r = (std::future<PhysxWrap::PhysxScene*>*)request;
+        if (r->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return 0;
+        }
+        *outScene = r->get();
+        delete r;
+        return 1;
+    }
+
     DLLIMPORT void DestroyScene(void *scene) {
         auto s = (PhysxWrap::PhysxScene*)scene;
         if (s) delete s;
@@ -38,6 +190,33 @@ extern "C" {
         s->Update(elapsedTime);
     }
 
+    DLLIMPORT void SetFixedTimestep(void *scene, float step, unsigned maxSubSteps) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->SetFixedTimestep(step, maxSubSteps);
+    }
+
+    DLLIMPORT void FlushQueryUpdates(void *scene) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->FlushQueryUpdates();
+    }
+
+    DLLIMPORT void GetInterpolatedPostion(void *scene, UINT64 id, void *outPostionX, void *outPostionY, void *outPostionZ) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        auto p = s->GetInterpolatedPostion(id);
+        *(float*)outPostionX = p.X;
+        *(float*)outPostionY = p.Y;
+        *(float*)outPostionZ = p.Z;
+    }
+
+    DLLIMPORT void GetInterpolatedRotate(void *scene, UINT64 id, void *outRotateX, void *outRotateY, void *outRotateZ, void *outRotateW) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        auto r = s->GetInterpolatedRotate(id);
+        *(float*)outRotateX = r.X;
+        *(float*)outRotateY = r.Y;
+        *(float*)outRotateZ = r.Z;
+        *(float*)outRotateW = r.W;
+    }
+
     DLLIMPORT UINT64 CreatePlane(void *scene, float yAxis) {
         auto s = (PhysxWrap::PhysxScene*)scene;
         return s->CreatePlane(yAxis);
@@ -88,6 +267,197 @@ extern "C" {
         return s->CreateCapsuleStatic(PhysxWrap::Vector3{ posX, posY, posZ }, radius, halfHeight);
     }
 
+    DLLIMPORT UINT64 CreateConvexDynamic(void *scene, float posX, float posY, float posZ, const float *points, int pointsLen, unsigned vertexLimit) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        std::vector<float> data(points, points + pointsLen);
+        return s->CreateConvexDynamic(PhysxWrap::Vector3{ posX, posY, posZ }, data, vertexLimit);
+    }
+
+    DLLIMPORT UINT64 CreateConvexKinematic(void *scene, float posX, float posY, float posZ, const float *points, int pointsLen, unsigned vertexLimit) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        std::vector<float> data(points, points + pointsLen);
+        return s->CreateConvexKinematic(PhysxWrap::Vector3{ posX, posY, posZ }, data, vertexLimit);
+    }
+
+    static PhysxWrap::BodyDesc makeBodyDesc(unsigned material, float density, float mass) {
+        PhysxWrap::BodyDesc body;
+        body.Material = material;
+        body.Density = density;
+        body.Mass = mass;
+        return body;
+    }
+
+    DLLIMPORT UINT64 CreateBoxDynamicEx(void *scene, float posX, float posY, float posZ, float halfExtentsX, float halfExtentsY, float halfExtentsZ, unsigned material, float density, float mass) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->CreateBoxDynamic(PhysxWrap::Vector3{ posX, posY, posZ }, PhysxWrap::Vector3{ halfExtentsX, halfExtentsY,halfExtentsZ }, makeBodyDesc(material, density, mass));
+    }
+
+    DLLIMPORT UINT64 CreateSphereDynamicEx(void *scene, float posX, float posY, float posZ, float radius, unsigned material, float density, float mass) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->CreateSphereDynamic(PhysxWrap::Vector3{ posX, posY, posZ }, radius, makeBodyDesc(material, density, mass));
+    }
+
+    DLLIMPORT UINT64 CreateCapsuleDynamicEx(void *scene, float posX, float posY, float posZ, float radius, float halfHeight, unsigned material, float density, float mass) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->CreateCapsuleDynamic(PhysxWrap::Vector3{ posX, posY, posZ }, radius, halfHeight, makeBodyDesc(material, density, mass));
+    }
+
+    static_assert(sizeof(PhysxWrap::ShapeDesc) == 56, "ShapeDesc layout is shared with the go side");
+
+    DLLIMPORT UINT64 CreateCompoundDynamic(void *scene, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, const void *shapes, int shapeCount, unsigned material, float density, float mass) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        auto begin = (const PhysxWrap::ShapeDesc*)shapes;
+        std::vector<PhysxWrap::ShapeDesc> data(begin, begin + (shapeCount > 0 ? shapeCount : 0));
+        return s->CreateCompoundDynamic(PhysxWrap::Vector3{ posX, posY, posZ }, PhysxWrap::Quat{ rotateX, rotateY, rotateZ, rotateW }, data, makeBodyDesc(material, density, mass));
+    }
+
+    DLLIMPORT UINT64 CreateCompoundKinematic(void *scene, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, const void *shapes, int shapeCount, unsigned material, float density, float mass) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        auto begin = (const PhysxWrap::ShapeDesc*)shapes;
+        std::vector<PhysxWrap::ShapeDesc> data(begin, begin + (shapeCount > 0 ? shapeCount : 0));
+        return s->CreateCompoundKinematic(PhysxWrap::Vector3{ posX, posY, posZ }, PhysxWrap::Quat{ rotateX, rotateY, rotateZ, rotateW }, data, makeBodyDesc(material, density, mass));
+    }
+
+    DLLIMPORT UINT64 CreateCompoundStatic(void *scene, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, const void *shapes, int shapeCount) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        auto begin = (const PhysxWrap::ShapeDesc*)shapes;
+        std::vector<PhysxWrap::ShapeDesc> data(begin, begin + (shapeCount > 0 ? shapeCount : 0));
+        return s->CreateCompoundStatic(PhysxWrap::Vector3{ posX, posY, posZ }, PhysxWrap::Quat{ rotateX, rotateY, rotateZ, rotateW }, data);
+    }
+
+    DLLIMPORT UINT64 CreateAggregate(void *scene, unsigned maxActors, int selfCollision) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->CreateAggregate(maxActors, selfCollision != 0);
+    }
+
+    DLLIMPORT int AddToAggregate(void *scene, UINT64 aggregateId, UINT64 id) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->AddToAggregate(aggregateId, id) ? 1 : 0;
+    }
+
+    DLLIMPORT void RemoveAggregate(void *scene, UINT64 aggregateId) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->RemoveAggregate(aggregateId);
+    }
+
+    DLLIMPORT UINT64 CreateCapsuleController(void *scene, float posX, float posY, float posZ, float radius, float halfHeight, float stepOffset, float slopeLimit) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->CreateCapsuleController(PhysxWrap::Vector3{ posX, posY, posZ }, radius, halfHeight, stepOffset, slopeLimit);
+    }
+
+    DLLIMPORT void MoveControllers(void *scene, const UINT64 *ids, const float *displacements, int count, float elapsedTime, unsigned char *outFlags) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        if (count <= 0) {
+            return;
+        }
+        static_assert(sizeof(PhysxWrap::Vector3) == 3 * sizeof(float), "displacements are passed as float triples");
+        s->MoveControllers((const uint64_t*)ids, (const PhysxWrap::Vector3*)displacements, unsigned(count), elapsedTime, outFlags);
+    }
+
+    DLLIMPORT UINT64 RegisterMesh(const float *vb, int vbLen, const unsigned short *ib, int ibLen) {
+        std::vector<float> vertices(vb, vb + vbLen);
+        std::vector<uint16_t> indices(ib, ib + ibLen);
+        return PhysxWrap::RegisterMesh(vertices, indices);
+    }
+
+    DLLIMPORT UINT64 RegisterMesh32(const float *vb, int vbLen, const unsigned int *ib, int ibLen) {
+        std::vector<float> vertices(vb, vb + vbLen);
+        std::vector<uint32_t> indices(ib, ib + ibLen);
+        return PhysxWrap::RegisterMesh32(vertices, indices);
+    }
+
+    DLLIMPORT void UnregisterMesh(UINT64 meshId) {
+        PhysxWrap::UnregisterMesh(meshId);
+    }
+
+    DLLIMPORT void SetMeshWeldTolerance(float tolerance) {
+        PhysxWrap::MeshCookingConfig config;
+        config.WeldTolerance = tolerance;
+        PhysxWrap::SetMeshCookingConfig(config);
+    }
+
+    DLLIMPORT void SetMeshCookingParams(float weldTolerance, int midphase, int cookingHint, float sizePerformanceTradeOff, unsigned trisPerLeaf, int suppressRemapTable, int disableActiveEdges) {
+        PhysxWrap::MeshCookingConfig config;
+        config.WeldTolerance = weldTolerance;
+        config.Midphase = midphase;
+        config.CookingHint = cookingHint;
+        config.SizePerformanceTradeOff = sizePerformanceTradeOff;
+        config.TrisPerLeaf = trisPerLeaf;
+        config.SuppressRemapTable = suppressRemapTable != 0;
+        config.DisableActiveEdges = disableActiveEdges != 0;
+        PhysxWrap::SetMeshCookingConfig(config);
+    }
+
+    DLLIMPORT UINT64 GetRegisteredMeshBytes() {
+        return PhysxWrap::GetRegisteredMeshBytes();
+    }
+
+    DLLIMPORT void UnloadSceneInfo(const char *path) {
+        PhysxWrap::UnloadSceneInfo(path);
+    }
+
+    DLLIMPORT void SetSceneCacheBudget(UINT64 bytes) {
+        PhysxWrap::SetSceneCacheBudget(bytes);
+    }
+
+    DLLIMPORT UINT64 GetSceneInfoBytes(const char *path) {
+        return PhysxWrap::GetSceneInfoBytes(path);
+    }
+
+    DLLIMPORT UINT64 GetSceneCacheBytes() {
+        return PhysxWrap::GetSceneCacheBytes();
+    }
+
+    DLLIMPORT int RaycastStaticWorld(const char *path, float originX, float originY, float originZ, float dirX, float dirY, float dirZ, float distance, void *outId, void *outPostion, void *outNormal, void *outDistance) {
+        PhysxWrap::RaycastHit hit;
+        if (!PhysxWrap::RaycastStaticWorld(path, PhysxWrap::Vector3{ originX, originY, originZ }, PhysxWrap::Vector3{ dirX, dirY, dirZ }, distance, hit)) {
+            return 0;
+        }
+        writeRaycastHit(hit, outId, outPostion, outNormal, outDistance);
+        return 1;
+    }
+
+    DLLIMPORT int RaycastStaticWorldBatch(const char *path, const float *origins, const float *dirs, const float *distances, int count, UINT64 *outIds, float *outPostions, float *outNormals, float *outDistances, unsigned char *outHit) {
+        if (count <= 0) {
+            return 1;
+        }
+        std::vector<PhysxWrap::RaycastHit> hits(count);
+        if (!PhysxWrap::RaycastStaticWorldBatch(path, (const PhysxWrap::Vector3*)origins, (const PhysxWrap::Vector3*)dirs, distances, unsigned(count), hits.data(), outHit)) {
+            return 0;
+        }
+        for (int i = 0; i < count; i++) {
+            if (outHit[i]) {
+                writeRaycastHit(hits[i], outIds + i, outPostions + i * 3, outNormals + i * 3, outDistances + i);
+            }
+        }
+        return 1;
+    }
+
+    DLLIMPORT int OverlapStaticWorldSphere(const char *path, float centerX, float centerY, float centerZ, float radius, unsigned *outIndices, int capacity) {
+        return int(PhysxWrap::OverlapStaticWorldSphere(path, PhysxWrap::Vector3{ centerX, centerY, centerZ }, radius, (uint32_t*)outIndices, capacity > 0 ? unsigned(capacity) : 0));
+    }
+
+    DLLIMPORT int SampleStaticWorldHeights(const char *path, const float *xz, int count, float *outHeights, unsigned char *outHit) {
+        if (count <= 0) {
+            return 1;
+        }
+        return PhysxWrap::SampleStaticWorldHeights(path, xz, unsigned(count), outHeights, outHit) ? 1 : 0;
+    }
+
+    DLLIMPORT void SetTerrainTileSize(unsigned cells) {
+        PhysxWrap::SetTerrainTileSize(cells);
+    }
+
+    DLLIMPORT UINT64 CreateMeshKinematic(void *scene, UINT64 meshId, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, float scaleX, float scaleY, float scaleZ) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->CreateMeshKinematic(meshId, PhysxWrap::Vector3{ posX, posY, posZ }, PhysxWrap::Quat{ rotateX, rotateY, rotateZ, rotateW }, PhysxWrap::Vector3{ scaleX, scaleY, scaleZ });
+    }
+
+    DLLIMPORT UINT64 CreateMeshStatic(void *scene, UINT64 meshId, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, float scaleX, float scaleY, float scaleZ) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->CreateMeshStatic(meshId, PhysxWrap::Vector3{ posX, posY, posZ }, PhysxWrap::Quat{ rotateX, rotateY, rotateZ, rotateW }, PhysxWrap::Vector3{ scaleX, scaleY, scaleZ });
+    }
+
     DLLIMPORT void RemoveActor(void *scene, UINT64 id) {
         auto s = (PhysxWrap::PhysxScene*)scene;
         s->RemoveActor(id);
@@ -145,6 +515,44 @@ extern "C" {
         return s->IsDynamicObj(id) ? 1 : 0;
     }
 
+    DLLIMPORT int SetTrigger(void *scene, UINT64 id, int trigger) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->SetTrigger(id, trigger != 0) ? 1 : 0;
+    }
+
+    DLLIMPORT void EnableContactEvents(void *scene, UINT64 id, int enable) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->EnableContactEvents(id, enable != 0);
+    }
+
+    DLLIMPORT void SetEventCapacity(void *scene, unsigned capacity) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->SetEventCapacity(capacity);
+    }
+
+    DLLIMPORT int DrainEvents(void *scene, void *buffer, int capacity) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        if (capacity <= 0) {
+            return 0;
+        }
+        return int(s->DrainEvents((PhysxWrap::PhysicsEvent*)buffer, unsigned(capacity)));
+    }
+
+    DLLIMPORT unsigned GetDroppedEvents(void *scene) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->GetDroppedEvents();
+    }
+
+    DLLIMPORT unsigned CreateMaterial(void *scene, float staticFriction, float dynamicFriction, float restitution) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->CreateMaterial(staticFriction, dynamicFriction, restitution);
+    }
+
+    DLLIMPORT void SetCurrentMaterialIndex(void *scene, unsigned index) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->SetCurrentMaterial(index);
+    }
+
     DLLIMPORT void SetCurrentMaterial(void *scene, float staticFriction, float dynamicFriction, float restitution) {
         auto s = (PhysxWrap::PhysxScene*)scene;
         s->SetCurrentMaterial(staticFriction, dynamicFriction, restitution);
@@ -155,6 +563,155 @@ extern "C" {
         s->SetCurrentAngularDamping(value);
     }
 
+    DLLIMPORT int Raycast(void *scene, float originX, float originY, float originZ, float dirX, float dirY, float dirZ, float distance, void *outId, void *outPostion, void *outNormal, void *outDistance) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        PhysxWrap::RaycastHit hit;
+        if (!s->Raycast(PhysxWrap::Vector3{ originX, originY, originZ }, PhysxWrap::Vector3{ dirX, dirY, dirZ }, distance, hit)) {
+            return 0;
+        }
+        writeRaycastHit(hit, outId, outPostion, outNormal, outDistance);
+        return 1;
+    }
+
+    DLLIMPORT int RaycastDynamic(void *scene, float originX, float originY, float originZ, float dirX, float dirY, float dirZ, float distance, void *outId, void *outPostion, void *outNormal, void *outDistance) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        PhysxWrap::RaycastHit hit;
+        if (!s->RaycastDynamic(PhysxWrap::Vector3{ originX, originY, originZ }, PhysxWrap::Vector3{ dirX, dirY, dirZ }, distance, hit)) {
+            return 0;
+        }
+        writeRaycastHit(hit, outId, outPostion, outNormal, outDistance);
+        return 1;
+    }
+
+    DLLIMPORT void EnableHistory(void *scene, unsigned frames) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->EnableHistory(frames);
+    }
+
+    DLLIMPORT float GetSimulationTime(void *scene) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        return s->GetSimulationTime();
+    }
+
+    DLLIMPORT int RaycastAt(void *scene, float time, float originX, float originY, float originZ, float dirX, float dirY, float dirZ, float distance, void *outId, void *outPostion, void *outNormal, void *outDistance) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        PhysxWrap::RaycastHit hit;
+        if (!s->RaycastAt(time, PhysxWrap::Vector3{ originX, originY, originZ }, PhysxWrap::Vector3{ dirX, dirY, dirZ }, distance, hit)) {
+            return 0;
+        }
+        writeRaycastHit(hit, outId, outPostion, outNormal, outDistance);
+        return 1;
+    }
+
+    DLLIMPORT int CaptureTransforms(void *scene, unsigned positionBits, void *outState, int capacity) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        std::vector<uint8_t> state;
+        s->CaptureTransforms(state, positionBits);
+        return copyOut(state, outState, capacity);
+    }
+
+    DLLIMPORT int EncodeTransformDelta(const void *baseline, int baselineSize, const void *state, int stateSize, void *outPacket, int capacity) {
+        std::vector<uint8_t> packet;
+        if (!PhysxWrap::EncodeTransformDelta(toBytes(baseline, baselineSize), toBytes(state, stateSize), packet)) {
+            return 0;
+        }
+        return copyOut(packet, outPacket, capacity);
+    }
+
+    DLLIMPORT int DecodeTransformDelta(const void *baseline, int baselineSize, const void *packet, int packetSize, void *outState, int capacity) {
+        std::vector<uint8_t> state;
+        if (!PhysxWrap::DecodeTransformDelta(toBytes(baseline, baselineSize), toBytes(packet, packetSize), state)) {
+            return 0;
+        }
+        return copyOut(state, outState, capacity);
+    }
+
+    DLLIMPORT int ReadTransforms(const void *state, int stateSize, UINT64 *outIds, float *outPostions, float *outRotates, int capacity) {
+        std::vector<uint64_t> ids;
+        std::vector<PhysxWrap::Vector3> postions;
+        std::vector<PhysxWrap::Quat> rotates;
+        if (!PhysxWrap::ReadTransforms(toBytes(state, stateSize), ids, postions, rotates)) {
+            return 0;
+        }
+        for (size_t i = 0; i < ids.size() && int(i) < capacity; i++) {
+            outIds[i] = ids[i];
+            outPostions[i * 3] = postions[i].X;
+            outPostions[i * 3 + 1] = postions[i].Y;
+            outPostions[i * 3 + 2] = postions[i].Z;
+            outRotates[i * 4] = rotates[i].X;
+            outRotates[i * 4 + 1] = rotates[i].Y;
+            outRotates[i * 4 + 2] = rotates[i].Z;
+            outRotates[i * 4 + 3] = rotates[i].W;
+        }
+        return int(ids.size());
+    }
+
+    DLLIMPORT void EnableInterest(void *scene, float cellSize) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        s->EnableInterest(cellSize);
+    }
+
+    DLLIMPORT int QueryInterest(void *scene, const float *observers, int count, float radius, UINT64 *outIds, int capacity, unsigned *outOffsets) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        if (count <= 0) {
+            return 0;
+        }
+        std::vector<uint64_t> ids;
+        std::vector<unsigned> offsets;
+        s->QueryInterest((const PhysxWrap::Vector3*)observers, unsigned(count), radius, ids, offsets);
+        memcpy(outOffsets, offsets.data(), offsets.size() * sizeof(unsigned));
+        if (outIds != nullptr && int(ids.size()) <= capacity) {
+            memcpy(outIds, ids.data(), ids.size() * sizeof(uint64_t));
+        }
+        return int(ids.size());
+    }
+
+    DLLIMPORT void SampleTerrainHeights(void *scene, const float *xz, int count, float *outHeights, unsigned char *outHit) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        if (count <= 0) {
+            return;
+        }
+        s->SampleTerrainHeights(xz, unsigned(count), outHeights, outHit);
+    }
+
+    DLLIMPORT int SnapshotScene(void *scene, void *buffer, int capacity) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        std::vector<uint8_t> snapshot;
+        s->Snapshot(snapshot);
+        if (buffer != nullptr && int(snapshot.size()) <= capacity) {
+            memcpy(buffer, snapshot.data(), snapshot.size());
+        }
+        return int(snapshot.size());
+    }
+
+    DLLIMPORT int RestoreScene(void *scene, const void *buffer, int size) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        std::vector<uint8_t> snapshot((const uint8_t*)buffer, (const uint8_t*)buffer + size);
+        return s->Restore(snapshot) ? 1 : 0;
+    }
+
+    DLLIMPORT void* CloneScene(void *scene, const void *snapshot, int size, UINT64 *outIdPairs, int capacity, int *outCount) {
+        auto s = (PhysxWrap::PhysxScene*)scene;
+        std::vector<uint8_t> data((const uint8_t*)snapshot, (const uint8_t*)snapshot + size);
+        std::unordered_map<uint64_t, uint64_t> idMap;
+        auto clone = s->Clone(data, idMap);
+        if (outCount) *outCount = int(idMap.size());
+        if (clone == nullptr) {
+            return nullptr;
+        }
+        if (outIdPairs == nullptr || int(idMap.size()) > capacity) {
+            // the id map would be lost: drop the clone, the caller retries with *outCount pairs
+            delete clone;
+            return nullptr;
+        }
+        int count = 0;
+        for (auto it = idMap.begin(); it != idMap.end(); ++it, ++count) {
+            outIdPairs[count * 2] = it->first;
+            outIdPairs[count * 2 + 1] = it->second;
+        }
+        return (void *)clone;
+    }
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
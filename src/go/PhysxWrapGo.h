@@ -13,11 +13,55 @@
 extern "C" {
 #endif
 
+    // mirror of PhysxWrap::SceneConfig; start from GetDefaultSceneConfig
+    typedef struct {
+        float GravityX, GravityY, GravityZ;
+        int EnablePCM;
+        int EnableStabilization;
+        int SuppressEagerRefit;
+        int EnableCCD;
+        int FrictionType;               // 0 patch, 1 one directional, 2 two directional
+        float BounceThreshold;
+        unsigned SolverPositionIterations;
+        unsigned SolverVelocityIterations;
+        float SleepThreshold;
+        int BroadPhase;                 // 0 SAP, 1 MBP
+        unsigned RegionSubdivisions;
+        float WorldMinX, WorldMinY, WorldMinZ;
+        float WorldMaxX, WorldMaxY, WorldMaxZ;
+        unsigned ThreadCount;
+        unsigned ScratchSize;
+        unsigned MaxActors;
+        unsigned MaxBodies;
+        unsigned MaxStaticShapes;
+        unsigned MaxDynamicShapes;
+        int ThreadSafe;
+        int QueryOnly;
+        unsigned DynamicTreeRebuildRate;
+        int EnhancedDeterminism;
+    } SceneConfigC;
+
     DLLIMPORT int InitPhysxSDK();
     DLLIMPORT void ReleasePhysxSDK();
     DLLIMPORT void* CreateScene(const char *path);
+    DLLIMPORT void GetDefaultSceneConfig(SceneConfigC *config);
+    DLLIMPORT void* CreateSceneEx(const char *path, const SceneConfigC *config);
+    // CreateSceneEx with every later change logged to logPath for ReplayRecording
+    DLLIMPORT void* CreateSceneRecorded(const char *path, const SceneConfigC *config, const char *logPath);
+    DLLIMPORT void StopRecording(void *scene);
+    // returns the Update count (-1 on failure); the first capacity Update times in ms go to outUpdateMs
+    DLLIMPORT int ReplayRecording(const char *logPath, unsigned threadCount, float *outUpdateMs, int capacity, UINT64 *outStateHash);
+    DLLIMPORT void PreloadSceneInfo(const char *path);
+    // builds the scene on the loader thread (config may be null); returns a request for PollSceneAsync
+    DLLIMPORT void* CreateSceneAsync(const char *path, const SceneConfigC *config);
+    // 0: pending. 1: done, *outScene is the scene (null if loading failed) and the request is freed
+    DLLIMPORT int PollSceneAsync(void *request, void **outScene);
     DLLIMPORT void DestroyScene(void *scene);
     DLLIMPORT void UpdateScene(void *scene, float elapsedTime); // second
+    DLLIMPORT void SetFixedTimestep(void *scene, float step, unsigned maxSubSteps);
+    DLLIMPORT void FlushQueryUpdates(void *scene);
+    DLLIMPORT void GetInterpolatedPostion(void *scene, UINT64 id, void *outPostionX, void *outPostionY, void *outPostionZ);
+    DLLIMPORT void GetInterpolatedRotate(void *scene, UINT64 id, void *outRotateX, void *outRotateY, void *outRotateZ, void *outRotateW);
 
     DLLIMPORT UINT64 CreatePlane(void *scene, float yAxis);
     DLLIMPORT UINT64 CreateBoxDynamic(void *scene, float posX, float posY, float posZ, float halfExtentsX, float halfExtentsY, float halfExtentsZ);
@@ -29,6 +73,45 @@ extern "C" {
     DLLIMPORT UINT64 CreateCapsuleDynamic(void *scene, float posX, float posY, float posZ, float radius, float halfHeight);
     DLLIMPORT UINT64 CreateCapsuleKinematic(void *scene, float posX, float posY, float posZ, float radius, float halfHeight);
     DLLIMPORT UINT64 CreateCapsuleStatic(void *scene, float posX, float posY, float posZ, float radius, float halfHeight);
+    DLLIMPORT UINT64 CreateConvexDynamic(void *scene, float posX, float posY, float posZ, const float *points, int pointsLen, unsigned vertexLimit);
+    DLLIMPORT UINT64 CreateConvexKinematic(void *scene, float posX, float posY, float posZ, const float *points, int pointsLen, unsigned vertexLimit);
+    // material: index from CreateMaterial or 0xFFFFFFFF for the current one; mass > 0 overrides density
+    DLLIMPORT UINT64 CreateBoxDynamicEx(void *scene, float posX, float posY, float posZ, float halfExtentsX, float halfExtentsY, float halfExtentsZ, unsigned material, float density, float mass);
+    DLLIMPORT UINT64 CreateSphereDynamicEx(void *scene, float posX, float posY, float posZ, float radius, unsigned material, float density, float mass);
+    DLLIMPORT UINT64 CreateCapsuleDynamicEx(void *scene, float posX, float posY, float posZ, float radius, float halfHeight, unsigned material, float density, float mass);
+
+    // shapes: shapeCount x 56-byte ShapeDesc {int type (0 box, 1 sphere, 2 capsule); float pos[3], rotate[4], halfExtents[3], radius, halfHeight; unsigned material}
+    DLLIMPORT UINT64 CreateCompoundDynamic(void *scene, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, const void *shapes, int shapeCount, unsigned material, float density, float mass);
+    DLLIMPORT UINT64 CreateCompoundKinematic(void *scene, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, const void *shapes, int shapeCount, unsigned material, float density, float mass);
+    DLLIMPORT UINT64 CreateCompoundStatic(void *scene, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, const void *shapes, int shapeCount);
+    DLLIMPORT UINT64 CreateAggregate(void *scene, unsigned maxActors, int selfCollision);
+    DLLIMPORT int AddToAggregate(void *scene, UINT64 aggregateId, UINT64 id);
+    DLLIMPORT void RemoveAggregate(void *scene, UINT64 aggregateId);
+    // slopeLimit in degrees; the returned id works with the actor functions below
+    DLLIMPORT UINT64 CreateCapsuleController(void *scene, float posX, float posY, float posZ, float radius, float halfHeight, float stepOffset, float slopeLimit);
+    // displacements: x,y,z x count; outFlags (may be null): count bytes of 1 = sides, 2 = up, 4 = down
+    DLLIMPORT void MoveControllers(void *scene, const UINT64 *ids, const float *displacements, int count, float elapsedTime, unsigned char *outFlags);
+
+    DLLIMPORT UINT64 RegisterMesh(const float *vb, int vbLen, const unsigned short *ib, int ibLen);
+    DLLIMPORT UINT64 RegisterMesh32(const float *vb, int vbLen, const unsigned int *ib, int ibLen);
+    DLLIMPORT void UnregisterMesh(UINT64 meshId);
+    DLLIMPORT void SetMeshWeldTolerance(float tolerance);
+    // midphase: 0 = BVH33, 1 = BVH34; cookingHint: 0 = sim performance, 1 = cooking performance
+    DLLIMPORT void SetMeshCookingParams(float weldTolerance, int midphase, int cookingHint, float sizePerformanceTradeOff, unsigned trisPerLeaf, int suppressRemapTable, int disableActiveEdges);
+    DLLIMPORT UINT64 GetRegisteredMeshBytes();
+    DLLIMPORT void UnloadSceneInfo(const char *path);
+    DLLIMPORT void SetTerrainTileSize(unsigned cells);
+    DLLIMPORT void SetSceneCacheBudget(UINT64 bytes);
+    DLLIMPORT UINT64 GetSceneInfoBytes(const char *path);
+    DLLIMPORT UINT64 GetSceneCacheBytes();
+    DLLIMPORT int RaycastStaticWorld(const char *path, float originX, float originY, float originZ, float dirX, float dirY, float dirZ, float distance, void *outId, void *outPostion, void *outNormal, void *outDistance);
+    // origins/dirs/outPostions/outNormals: float[3 * count]; outHit[i] is 1 when ray i hit
+    DLLIMPORT int RaycastStaticWorldBatch(const char *path, const float *origins, const float *dirs, const float *distances, int count, UINT64 *outIds, float *outPostions, float *outNormals, float *outDistances, unsigned char *outHit);
+    DLLIMPORT int OverlapStaticWorldSphere(const char *path, float centerX, float centerY, float centerZ, float radius, unsigned *outIndices, int capacity);
+    // xz: float[2 * count]; outHeights: float[count]
+    DLLIMPORT int SampleStaticWorldHeights(const char *path, const float *xz, int count, float *outHeights, unsigned char *outHit);
+    DLLIMPORT UINT64 CreateMeshKinematic(void *scene, UINT64 meshId, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, float scaleX, float scaleY, float scaleZ);
+    DLLIMPORT UINT64 CreateMeshStatic(void *scene, UINT64 meshId, float posX, float posY, float posZ, float rotateX, float rotateY, float rotateZ, float rotateW, float scaleX, float scaleY, float scaleZ);
 
     DLLIMPORT void RemoveActor(void *scene, UINT64 id);
 
@@ -44,9 +127,38 @@ extern "C" {
     DLLIMPORT int IsStaticObj(void *scene, UINT64 id);
     DLLIMPORT int IsDynamicObj(void *scene, UINT64 id);
 
+    DLLIMPORT int SetTrigger(void *scene, UINT64 id, int trigger);
+    DLLIMPORT void EnableContactEvents(void *scene, UINT64 id, int enable);
+    DLLIMPORT void SetEventCapacity(void *scene, unsigned capacity);
+    // buffer: capacity x 48-byte events {UINT64 id0, id1; float point[3], normal[3], impulse; uint32 type}; returns the count
+    DLLIMPORT int DrainEvents(void *scene, void *buffer, int capacity);
+    DLLIMPORT unsigned GetDroppedEvents(void *scene);
+
+    DLLIMPORT unsigned CreateMaterial(void *scene, float staticFriction, float dynamicFriction, float restitution);
+    DLLIMPORT void SetCurrentMaterialIndex(void *scene, unsigned index);
     DLLIMPORT void SetCurrentMaterial(void *scene, float staticFriction, float dynamicFriction, float restitution);
     DLLIMPORT void SetCurrentAngularDamping(void *scene, float value);
 
+    DLLIMPORT int Raycast(void *scene, float originX, float originY, float originZ, float dirX, float dirY, float dirZ, float distance, void *outId, void *outPostion, void *outNormal, void *outDistance); // outPostion/outNormal: float[3]
+    DLLIMPORT int RaycastDynamic(void *scene, float originX, float originY, float originZ, float dirX, float dirY, float dirZ, float distance, void *outId, void *outPostion, void *outNormal, void *outDistance);
+    DLLIMPORT void EnableHistory(void *scene, unsigned frames);
+    DLLIMPORT float GetSimulationTime(void *scene);
+    DLLIMPORT int RaycastAt(void *scene, float time, float originX, float originY, float originZ, float dirX, float dirY, float dirZ, float distance, void *outId, void *outPostion, void *outNormal, void *outDistance);
+    // the transform functions return the output size and write it only when it fits in capacity; 0 on bad input
+    DLLIMPORT int CaptureTransforms(void *scene, unsigned positionBits, void *outState, int capacity);
+    DLLIMPORT int EncodeTransformDelta(const void *baseline, int baselineSize, const void *state, int stateSize, void *outPacket, int capacity);
+    DLLIMPORT int DecodeTransformDelta(const void *baseline, int baselineSize, const void *packet, int packetSize, void *outState, int capacity);
+    // returns the actor count; outPostions: float[3 * capacity], outRotates: float[4 * capacity]
+    DLLIMPORT int ReadTransforms(const void *state, int stateSize, UINT64 *outIds, float *outPostions, float *outRotates, int capacity);
+    DLLIMPORT void EnableInterest(void *scene, float cellSize);
+    // observers: float[3 * count], outOffsets: unsigned[count + 1]; returns the id count, ids are written only when it fits in capacity
+    DLLIMPORT int QueryInterest(void *scene, const float *observers, int count, float radius, UINT64 *outIds, int capacity, unsigned *outOffsets);
+    DLLIMPORT void SampleTerrainHeights(void *scene, const float *xz, int count, float *outHeights, unsigned char *outHit);
+
+    DLLIMPORT int SnapshotScene(void *scene, void *buffer, int capacity); // returns snapshot size; nothing is written when capacity is too small
+    DLLIMPORT int RestoreScene(void *scene, const void *buffer, int size);
+    DLLIMPORT void* CloneScene(void *scene, const void *snapshot, int size, UINT64 *outIdPairs, int capacity, int *outCount); // outIdPairs: (old id, new id) x capacity; *outCount gets the pair count, and when it exceeds capacity nothing is written and no clone is returned
+
 #ifdef __cplusplus
 }
 #endif
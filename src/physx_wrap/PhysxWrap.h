@@ -3,6 +3,10 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <functional>
+#include <future>
 
 #ifdef EXPORT_DLL
 #define MY_DLL_EXPORT_CLASS __declspec(dllexport)
@@ -26,6 +30,149 @@ namespace PhysxWrap {
         float W;
     };
 
+    struct MY_DLL_EXPORT_CLASS Material {
+        float StaticFriction;
+        float DynamicFriction;
+        float Restitution;
+    };
+
+    // heightfield cell material index that leaves the cell empty
+    enum { eTerrainHole = 127 };
+
+    // material palette index meaning the room's current material
+    enum : unsigned { eCurrentMaterial = 0xFFFFFFFF };
+
+    struct MY_DLL_EXPORT_CLASS BodyDesc {
+        BodyDesc();
+
+        unsigned Material;  // index returned by PhysxScene::CreateMaterial, default eCurrentMaterial
+        float Density;      // default 1
+        float Mass;         // > 0 overrides the mass computed from Density, which is then ignored
+    };
+
+    enum ShapeType {
+        eShapeBox = 0,
+        eShapeSphere = 1,
+        eShapeCapsule = 2,  // along the local x axis, like CreateCapsule*
+    };
+
+    // one shape of a compound actor
+    struct MY_DLL_EXPORT_CLASS ShapeDesc {
+        ShapeDesc();
+
+        int Type;               // ShapeType
+        Vector3 Postion;        // local pose relative to the actor
+        Quat Rotate;
+        Vector3 HalfExtents;    // box
+        float Radius;           // sphere, capsule
+        float HalfHeight;       // capsule
+        unsigned Material;      // palette index; eCurrentMaterial uses the body's (or the room's) material
+    };
+
+    enum PhysicsEventType {
+        eContactBegin = 1,
+        eContactEnd = 2,
+        eTriggerEnter = 3,  // Id0 is the trigger
+        eTriggerExit = 4,
+    };
+
+    // 48 bytes, plain data so a drained array can be handed to Go as is
+    struct MY_DLL_EXPORT_CLASS PhysicsEvent {
+        uint64_t Id0;
+        uint64_t Id1;
+        Vector3 Point;      // contacts only: first contact point
+        Vector3 Normal;     // contacts only: points from Id1 to Id0
+        float Impulse;      // contacts only: total impulse of the pair this step
+        uint32_t Type;      // PhysicsEventType
+    };
+
+    // MoveControllers result bits
+    enum ControllerCollisionFlag {
+        eCollisionSides = 1,
+        eCollisionUp = 2,
+        eCollisionDown = 4,     // standing on something
+    };
+
+    struct MY_DLL_EXPORT_CLASS RaycastHit {
+        uint64_t Id;
+        Vector3 Postion;
+        Vector3 Normal;
+        float Distance;
+    };
+
+    enum MeshMidphase {
+        eMidphaseBVH33 = 0,     // PhysX default, tunable by CookingHint/SizePerformanceTradeOff
+        eMidphaseBVH34 = 1,     // faster cooking and queries, more memory; tunable by TrisPerLeaf
+    };
+
+    enum MeshCookingHint {
+        eHintSimPerformance = 0,
+        eHintCookingPerformance = 1,
+    };
+
+    struct MY_DLL_EXPORT_CLASS MeshCookingConfig {
+        MeshCookingConfig();
+
+        float WeldTolerance;            // > 0 merges vertices closer than this while cooking
+        int Midphase;                   // MeshMidphase
+        int CookingHint;                // MeshCookingHint, BVH33 only
+        float SizePerformanceTradeOff;  // BVH33 only, 0 = smallest .. 1 = fastest queries
+        unsigned TrisPerLeaf;           // BVH34 only, 4..15, more = smaller and slower
+        bool SuppressRemapTable;        // saves 4 bytes per triangle; hit face indices then refer to cooked triangles
+        bool DisableActiveEdges;        // faster cooking, rougher contacts on internal edges
+    };
+
+    enum BroadPhaseType {
+        eBroadPhaseSAP = 0,     // PhysX default
+        eBroadPhaseMBP = 1,     // grid regions; suits large flat maps with many spread-out dynamics
+    };
+
+    enum FrictionModel {
+        eFrictionPatch = 0,             // PhysX default
+        eFrictionOneDirectional = 1,
+        eFrictionTwoDirectional = 2,
+    };
+
+    // scene descriptor of a room, fixed at Init; defaults match the previous hard-coded setup
+    struct MY_DLL_EXPORT_CLASS SceneConfig {
+        SceneConfig();
+
+        Vector3 Gravity;                // default (0, -9.81, 0)
+        bool EnablePCM;                 // persistent contact manifolds, default true
+        bool EnableStabilization;       // default true
+        bool SuppressEagerRefit;        // query trees are refit by the first query after a step, default true
+        bool EnableCCD;                 // swept contacts for fast dynamics, default false
+        int FrictionType;               // FrictionModel
+        float BounceThreshold;          // relative speed below which contacts do not bounce, default 2
+        unsigned SolverPositionIterations;  // per dynamic actor, 1..255, default 4
+        unsigned SolverVelocityIterations;  // per dynamic actor, 1..255, default 1
+        float SleepThreshold;           // mass-normalized kinetic energy below which dynamics may sleep, default 0.005
+
+        int BroadPhase;                 // BroadPhaseType
+        unsigned RegionSubdivisions;    // MBP: the world bounds are split into n x n regions on the ground plane, 1..16
+        Vector3 WorldMin;               // MBP: world bounds; left empty they come from the scene file in CreateScene.
+        Vector3 WorldMax;               // actors outside every region do not collide
+
+        unsigned ThreadCount;           // dispatcher worker threads; 0 (default) simulates on the calling thread, ThreadSafe scenes use at least 1
+        unsigned ScratchSize;           // simulate scratch memory in bytes, rounded down to 16KB, default 128KB; 0 disables
+        unsigned MaxActors;             // preallocation hints, 0 (default) grows on demand
+        unsigned MaxBodies;
+        unsigned MaxStaticShapes;
+        unsigned MaxDynamicShapes;
+        // lock the scene for every call so Raycast and the getters can run on other threads,
+        // reading the previous frame while Update simulates on the worker threads; otherwise all calls must come from one thread
+        bool ThreadSafe;
+        // never simulate: Update only brings the scene query trees up to date after SetGlobalPostion/SetGlobalRotate moves,
+        // so gravity, velocities and forces have no effect. Implies SuppressEagerRefit
+        bool QueryOnly;
+        // frames over which the dynamic query tree is rebuilt in the background, at least 4, default 100;
+        // QueryOnly scenes rebuild it outright every this many Updates instead
+        unsigned DynamicTreeRebuildRate;
+        // same inputs in the same order give the same results whatever the thread count or the other actors in broadphase
+        // islands, at some solver cost; default false. Replays force it on
+        bool EnhancedDeterminism;
+    };
+
     class PhysxSceneImpl;
     class MY_DLL_EXPORT_CLASS PhysxScene
     {
@@ -34,22 +181,62 @@ namespace PhysxWrap {
         ~PhysxScene();
 
         bool Init();
+        bool Init(const SceneConfig &config);
         bool CreateScene(const std::string &path);
+        // Init + CreateScene on a loader thread; the room is handed over ready, or nullptr if either failed.
+        // Rooms of an already cached scene do not queue behind scene file loads.
+        // the callback runs on the loader thread
+        static void CreateSceneAsync(const std::string &path, const SceneConfig &config, const std::function<void(PhysxScene*)> &callback);
+        static std::future<PhysxScene*> CreateSceneAsync(const std::string &path, const SceneConfig &config = SceneConfig());
         void Update(float elapsedTime); // second
+        // applies pending pose changes to the scene query trees now instead of at the next query
+        void FlushQueryUpdates();
+
+        // fixed-step mode: Update accumulates elapsedTime and runs at most maxSubSteps steps of `step` seconds; step <= 0 restores variable steps
+        void SetFixedTimestep(float step, unsigned maxSubSteps);
+        float GetInterpolationAlpha();
+        Vector3 GetInterpolatedPostion(uint64_t id);
+        Quat GetInterpolatedRotate(uint64_t id);
 
         uint64_t CreatePlane(float yAxis);
         uint64_t CreateHeightField(const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale);
-        uint64_t CreateBoxDynamic(const Vector3 &pos, const Vector3 &halfExtents);
-        uint64_t CreateBoxKinematic(const Vector3 &pos, const Vector3 &halfExtents);
-        uint64_t CreateBoxStatic(const Vector3 &pos, const Vector3 &halfExtents);
-        uint64_t CreateSphereDynamic(const Vector3 &pos, float radius);
-        uint64_t CreateSphereKinematic(const Vector3 &pos, float radius);
-        uint64_t CreateSphereStatic(const Vector3 &pos, float radius);
-        uint64_t CreateCapsuleDynamic(const Vector3 &pos, float radius, float halfHeight);
-        uint64_t CreateCapsuleKinematic(const Vector3 &pos, float radius, float halfHeight);
-        uint64_t CreateCapsuleStatic(const Vector3 &pos, float radius, float halfHeight);
-        uint64_t CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib);
-        uint64_t CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib);
+        // cellMaterials: one index into materials per cell ((rows - 1) * (columns - 1), row-major), or eTerrainHole
+        uint64_t CreateHeightField(const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale, const std::vector<uint8_t> &cellMaterials, const std::vector<Material> &materials);
+        uint64_t CreateBoxDynamic(const Vector3 &pos, const Vector3 &halfExtents, const BodyDesc &body = BodyDesc());
+        uint64_t CreateBoxKinematic(const Vector3 &pos, const Vector3 &halfExtents, const BodyDesc &body = BodyDesc());
+        uint64_t CreateBoxStatic(const Vector3 &pos, const Vector3 &halfExtents, unsigned material = eCurrentMaterial);
+        uint64_t CreateSphereDynamic(const Vector3 &pos, float radius, const BodyDesc &body = BodyDesc());
+        uint64_t CreateSphereKinematic(const Vector3 &pos, float radius, const BodyDesc &body = BodyDesc());
+        uint64_t CreateSphereStatic(const Vector3 &pos, float radius, unsigned material = eCurrentMaterial);
+        uint64_t CreateCapsuleDynamic(const Vector3 &pos, float radius, float halfHeight, const BodyDesc &body = BodyDesc());
+        uint64_t CreateCapsuleKinematic(const Vector3 &pos, float radius, float halfHeight, const BodyDesc &body = BodyDesc());
+        uint64_t CreateCapsuleStatic(const Vector3 &pos, float radius, float halfHeight, unsigned material = eCurrentMaterial);
+        // points: x,y,z triples; the hull is cooked once per process per distinct point set and vertex limit (4..255)
+        uint64_t CreateConvexDynamic(const Vector3 &pos, const std::vector<float> &points, unsigned vertexLimit, const BodyDesc &body = BodyDesc());
+        uint64_t CreateConvexKinematic(const Vector3 &pos, const std::vector<float> &points, unsigned vertexLimit, const BodyDesc &body = BodyDesc());
+        uint64_t CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, const BodyDesc &body = BodyDesc());
+        uint64_t CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, unsigned material = eCurrentMaterial);
+        uint64_t CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib, const BodyDesc &body = BodyDesc());
+        uint64_t CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib, unsigned material = eCurrentMaterial);
+        uint64_t CreateMeshKinematic(uint64_t meshId, const Vector3 &pos, const Quat &rotate, const Vector3 &scale, const BodyDesc &body = BodyDesc());
+        uint64_t CreateMeshStatic(uint64_t meshId, const Vector3 &pos, const Quat &rotate, const Vector3 &scale, unsigned material = eCurrentMaterial);
+
+        // character controller: kinematic capsule moved by MoveControllers with collision, step and slope handling.
+        // the id is an actor id whose postion is the capsule center; slopeLimit in degrees, 0 walks any slope
+        uint64_t CreateCapsuleController(const Vector3 &pos, float radius, float halfHeight, float stepOffset, float slopeLimit);
+        // moves ids[i] by displacements[i]; outFlags (optional) receives the ControllerCollisionFlag bits of each move
+        void MoveControllers(const uint64_t *ids, const Vector3 *displacements, unsigned count, float elapsedTime, uint8_t *outFlags = nullptr);
+
+        // one actor with several shapes; the body's mass and inertia are computed over all of them
+        uint64_t CreateCompoundDynamic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body = BodyDesc());
+        uint64_t CreateCompoundKinematic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body = BodyDesc());
+        uint64_t CreateCompoundStatic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes);
+
+        // aggregate: up to maxActors (1..128) actors the broadphase treats as one bounds; selfCollision off skips pairs inside it
+        uint64_t CreateAggregate(unsigned maxActors, bool selfCollision);
+        bool AddToAggregate(uint64_t aggregateId, uint64_t id);
+        // the actors stay in the room
+        void RemoveAggregate(uint64_t aggregateId);
 
         void RemoveActor(uint64_t id);
 
@@ -65,15 +252,108 @@ namespace PhysxWrap {
         bool IsStaticObj(uint64_t id);
         bool IsDynamicObj(uint64_t id);
 
+        // trigger shapes do not collide and report eTriggerEnter/eTriggerExit; mesh and heightfield actors can't be triggers
+        bool SetTrigger(uint64_t id, bool trigger);
+        // contacts involving this actor report eContactBegin/eContactEnd
+        void EnableContactEvents(uint64_t id, bool enable);
+        // events are buffered during Update into a preallocated array of `capacity` (default 1024); overflow is dropped
+        void SetEventCapacity(unsigned capacity);
+        // moves up to `capacity` buffered events into `buffer`, returns the count
+        unsigned DrainEvents(PhysicsEvent *buffer, unsigned capacity);
+        // events dropped since the last call
+        unsigned GetDroppedEvents();
+
+        // per-room material palette; index 0 is the initial material. Existing actors are never changed.
+        unsigned CreateMaterial(float staticFriction, float dynamicFriction, float restitution);
+        void SetCurrentMaterial(unsigned index);
+        // selects the palette entry with these values, adding one if needed
         void SetCurrentMaterial(float staticFriction, float dynamicFriction, float restitution);
         void SetCurrentAngularDamping(float value);
 
+        bool Raycast(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit);
+        // dynamic and kinematic actors only; combine with RaycastStaticWorld for the map
+        bool RaycastDynamic(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit);
+
+        // lag compensation: keep primitive proxies of dynamic/kinematic actors for the last `frames` simulation steps (0 disables)
+        void EnableHistory(unsigned frames);
+        float GetSimulationTime(); // second
+        // raycast against the moving actors as they were at simulation time `time`; the live scene is not touched
+        bool RaycastAt(float time, const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit);
+
+        // network state of all dynamic/kinematic actors: positions quantized to `positionBits` per axis over WorldMin..WorldMax
+        // (else the room's bounds when first called), rotations smallest-three in 32 bits. Diff two with EncodeTransformDelta
+        void CaptureTransforms(std::vector<uint8_t> &state, unsigned positionBits = 18);
+
+        // area of interest: actors not loaded from the scene file bucketed in a horizontal grid of `cellSize`,
+        // updated each step from the actors that moved; 0 disables
+        void EnableInterest(float cellSize);
+        // ids within horizontal `radius` of each observer: those of observer i are ids[offsets[i]] .. ids[offsets[i + 1] - 1]
+        void QueryInterest(const Vector3 *observers, unsigned count, float radius, std::vector<uint64_t> &ids, std::vector<unsigned> &offsets);
+
+        // ground snapping: height of the highest static surface under each x,z pair (xz: 2 * count floats), outHit[i] 1 when found.
+        // Read straight from the terrains (scene file and CreateHeightField); downward raycasts only over the cells the
+        // scene file's other objects overlap, holes and tilted terrains. Static actors created at runtime are only seen there
+        void SampleTerrainHeights(const float *xz, unsigned count, float *heights, uint8_t *outHit);
+
+        // dynamic state (poses, velocities, sleep state, kinematic targets) packed into one contiguous buffer
+        void Snapshot(std::vector<uint8_t> &buffer);
+        bool Restore(const std::vector<uint8_t> &buffer);
+        // new room sharing this room's loaded scene file, with runtime actors copied (controllers and aggregates are not) and set to `snapshot`; idMap maps old ids to new ones
+        PhysxScene* Clone(const std::vector<uint8_t> &snapshot, std::unordered_map<uint64_t, uint64_t> &idMap);
+
+        // log every call that changes the room (CreateScene, Update, creates, setters) to `path` for ReplayRecording.
+        // Call right after Init: it fails once anything is created or set (CreateScene, SetFixedTimestep, materials,
+        // SetCurrentAngularDamping, EnableHistory, EnableInterest), since the log only starts from the config. Queries are not recorded.
+        // Restore and CreateMesh*(meshId) can't be replayed: they end the log and ReplayRecording then fails
+        bool StartRecording(const std::string &path);
+        void StopRecording();
+
     private:
         void release();
         PhysxSceneImpl* mImpl;
     };
 
     MY_DLL_EXPORT_FUNC unsigned GetStaticObjCountInScene(const std::string &path);
+    // loads and cooks a scene file into the cache on the loader thread, so later CreateScene calls only insert actors
+    MY_DLL_EXPORT_FUNC void PreloadSceneInfo(const std::string &path);
+    // drops the cached scene file so the next CreateScene reloads (and re-cooks) it; rooms already using it keep their copy
+    MY_DLL_EXPORT_FUNC void UnloadSceneInfo(const std::string &path);
+    // cached scene files beyond `bytes` are evicted least recently used first, skipping those a room still uses; 0 (default) keeps all
+    MY_DLL_EXPORT_FUNC void SetSceneCacheBudget(uint64_t bytes);
+    // approximate size of a cached scene file (0 if not cached), and of the whole cache
+    MY_DLL_EXPORT_FUNC uint64_t GetSceneInfoBytes(const std::string &path);
+    MY_DLL_EXPORT_FUNC uint64_t GetSceneCacheBytes();
+    // queries against the static objects of a cached scene file, shared by all rooms on the map and safe from any thread.
+    // false / 0 when the file is not cached. hit.Id is the object index in the file (terrains, boxes, capsules, meshes, spheres)
+    MY_DLL_EXPORT_FUNC bool RaycastStaticWorld(const std::string &path, const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit);
+    // rays are traced 4 at a time; outHit[i] is 1 when hits[i] is valid
+    MY_DLL_EXPORT_FUNC bool RaycastStaticWorldBatch(const std::string &path, const Vector3 *origins, const Vector3 *unitDirs, const float *distances, unsigned count, RaycastHit *hits, uint8_t *outHit);
+    // fills at most `capacity` indices of objects touching the sphere, returns how many touch it
+    MY_DLL_EXPORT_FUNC unsigned OverlapStaticWorldSphere(const std::string &path, const Vector3 &center, float radius, uint32_t *indices, unsigned capacity);
+    // PhysxScene::SampleTerrainHeights over a cached scene file alone, from any thread; false when the file is not cached
+    MY_DLL_EXPORT_FUNC bool SampleStaticWorldHeights(const std::string &path, const float *xz, unsigned count, float *heights, uint8_t *outHit);
+    // packet of the actors that moved, appeared or disappeared between `baseline` (a CaptureTransforms state, empty for a full update) and `state`
+    MY_DLL_EXPORT_FUNC bool EncodeTransformDelta(const std::vector<uint8_t> &baseline, const std::vector<uint8_t> &state, std::vector<uint8_t> &packet);
+    // receiver side: rebuilds `state` from the same baseline and the packet
+    MY_DLL_EXPORT_FUNC bool DecodeTransformDelta(const std::vector<uint8_t> &baseline, const std::vector<uint8_t> &packet, std::vector<uint8_t> &state);
+    // re-runs a StartRecording log on a new room with EnhancedDeterminism and `threadCount` dispatcher threads.
+    // updateMs receives the wall time of every Update, stateHash a hash of the final dynamic poses (equal across runs and thread counts)
+    MY_DLL_EXPORT_FUNC bool ReplayRecording(const std::string &path, unsigned threadCount, std::vector<float> &updateMs, uint64_t &stateHash);
+    // dequantized poses of a state, sorted by id
+    MY_DLL_EXPORT_FUNC bool ReadTransforms(const std::vector<uint8_t> &state, std::vector<uint64_t> &ids, std::vector<Vector3> &postions, std::vector<Quat> &rotates);
+    // terrains of scenes loaded afterwards are split into heightfields of at most `cells` x `cells`; 0 (default) keeps one per terrain
+    MY_DLL_EXPORT_FUNC void SetTerrainTileSize(unsigned cells);
+    // cooked once per process and shared by all rooms; each call takes a reference released by UnregisterMesh
+    MY_DLL_EXPORT_FUNC uint64_t RegisterMesh(const std::vector<float> &vb, const std::vector<uint16_t> &ib);
+    MY_DLL_EXPORT_FUNC uint64_t RegisterMesh32(const std::vector<float> &vb, const std::vector<uint32_t> &ib);
+    // cooked with `config` instead of the global one; meshes are shared only with registrations using the same config
+    MY_DLL_EXPORT_FUNC uint64_t RegisterMeshWithConfig(const std::vector<float> &vb, const std::vector<uint16_t> &ib, const MeshCookingConfig &config);
+    MY_DLL_EXPORT_FUNC uint64_t RegisterMesh32WithConfig(const std::vector<float> &vb, const std::vector<uint32_t> &ib, const MeshCookingConfig &config);
+    MY_DLL_EXPORT_FUNC void UnregisterMesh(uint64_t meshId);
+    // cooked size of all registered triangle meshes
+    MY_DLL_EXPORT_FUNC uint64_t GetRegisteredMeshBytes();
+    // applies to meshes cooked afterwards
+    MY_DLL_EXPORT_FUNC void SetMeshCookingConfig(const MeshCookingConfig &config);
     MY_DLL_EXPORT_FUNC bool InitPhysxSDK();
     MY_DLL_EXPORT_FUNC void ReleasePhysxSDK();
 };
@@ -0,0 +1,70 @@
+#include "async_loader.h"
+
+namespace PhysxWrap {
+
+    AsyncLoader __gAsyncLoader;
+    AsyncLoader* gAsyncLoader = &__gAsyncLoader;
+    AsyncLoader __gRoomLoader;
+    AsyncLoader* gRoomLoader = &__gRoomLoader;
+
+    AsyncLoader::AsyncLoader()
+        : mRunning(false)
+        , mStopping(false)
+    {
+
+    }
+
+    AsyncLoader::~AsyncLoader() {
+        Stop();
+    }
+
+    void AsyncLoader::Post(const std::function<void()> &task) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(task);
+        if (!mRunning) {
+            mRunning = true;
+            mThread = std::thread(&AsyncLoader::run, this);
+        }
+        mCond.notify_one();
+    }
+
+    void AsyncLoader::Stop() {
+        std::thread thread;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mRunning) {
+                return;
+            }
+            mStopping = true;
+            mCond.notify_one();
+            thread = std::move(mThread);
+        }
+        // tasks posted meanwhile still run on the old thread before it exits
+        thread.join();
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = false;
+        if (mTasks.empty()) {
+            mRunning = false;
+        }
+        else {
+            // posted after the old thread left its loop, while Post still saw it running: they get a new one
+            mThread = std::thread(&AsyncLoader::run, this);
+        }
+    }
+
+    void AsyncLoader::run() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true) {
+            mCond.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+            if (mTasks.empty()) {
+                break;
+            }
+            auto task = std::move(mTasks.front());
+            mTasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+}
@@ -0,0 +1,41 @@
+#ifndef __ASYNC_LOADER_H__
+#define __ASYNC_LOADER_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace PhysxWrap {
+
+    // background thread for scene loading and room creation, started by the first Post.
+    // Tasks run in order; Stop runs what is queued, then joins. Tasks posted while it joins start a new thread.
+    // gAsyncLoader takes the tasks that may load a scene file, gRoomLoader the rooms whose scene is already
+    // cached, so those do not wait behind a cold load.
+    class AsyncLoader
+    {
+    public:
+        AsyncLoader();
+        ~AsyncLoader();
+
+        void Post(const std::function<void()> &task);
+        void Stop();
+
+    private:
+        void run();
+
+        std::mutex mMutex;
+        std::condition_variable mCond;
+        std::deque<std::function<void()>> mTasks;
+        std::thread mThread;
+        bool mRunning;
+        bool mStopping;
+    };
+
+    extern AsyncLoader* gAsyncLoader;
+    extern AsyncLoader* gRoomLoader;
+
+};
+
+#endif
@@ -0,0 +1,495 @@
+#include "command_log.h"
+#include "util.h"
+#include "log.h"
+#include <chrono>
+#include <map>
+
+#define COMMAND_LOG_MAGIC (0x43525850)  // "PXRC"
+#define COMMAND_LOG_VERSION (2)
+#define COMMAND_LOG_BUFFER (64 * 1024)
+
+namespace PhysxWrap {
+
+    struct CommandLogHeader {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t ConfigSize;    // bytes of the SceneConfig fields that follow, written one by one
+    };
+
+    CommandRecorder::CommandRecorder()
+        : mFile(nullptr)
+    {
+
+    }
+
+    CommandRecorder::~CommandRecorder() {
+        Close();
+    }
+
+    bool CommandRecorder::Open(const std::string &path, const SceneConfig &config) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFile != nullptr) {
+            fclose(mFile);
+        }
+        mFile = fopen(path.c_str(), "wb");
+        if (mFile == nullptr) {
+            ERROR("[physx] open command log fail. path = %s", path.c_str());
+            return false;
+        }
+        setvbuf(mFile, nullptr, _IOFBF, COMMAND_LOG_BUFFER);
+        mPayload.clear();
+        putConfig(config);
+        CommandLogHeader header = { COMMAND_LOG_MAGIC, COMMAND_LOG_VERSION, uint32_t(mPayload.size()) };
+        fwrite(&header, sizeof(header), 1, mFile);
+        fwrite(mPayload.data(), 1, mPayload.size(), mFile);
+        return true;
+    }
+
+    void CommandRecorder::putConfig(const SceneConfig &config) {
+        // field by field like the records: the struct has padding and may grow; keep readConfig in step
+        append(config.Gravity, config.EnablePCM, config.EnableStabilization, config.SuppressEagerRefit, config.EnableCCD,
+            config.FrictionType, config.BounceThreshold, config.SolverPositionIterations, config.SolverVelocityIterations, config.SleepThreshold,
+            config.BroadPhase, config.RegionSubdivisions, config.WorldMin, config.WorldMax,
+            config.ThreadCount, config.ScratchSize, config.MaxActors, config.MaxBodies, config.MaxStaticShapes, config.MaxDynamicShapes,
+            config.ThreadSafe, config.QueryOnly, config.DynamicTreeRebuildRate, config.EnhancedDeterminism);
+    }
+
+    void CommandRecorder::Invalidate(const char *call) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFile == nullptr) {
+            return;
+        }
+        ERROR("[physx] %s is not recorded, the command log is closed and can't be replayed", call);
+        mPayload.clear();
+        put(std::string(call));
+        writeRecord(eOpUnrecorded);
+        fclose(mFile);
+        mFile = nullptr;
+    }
+
+    void CommandRecorder::Close() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFile != nullptr) {
+            fclose(mFile);
+            mFile = nullptr;
+        }
+    }
+
+    void CommandRecorder::writeRecord(CommandOp op) {
+        uint8_t code = op;
+        uint32_t size = uint32_t(mPayload.size());
+        fwrite(&code, sizeof(code), 1, mFile);
+        fwrite(&size, sizeof(size), 1, mFile);
+        if (size > 0) {
+            fwrite(mPayload.data(), 1, size, mFile);
+        }
+    }
+
+    // reads one record's payload; a short payload marks the reader failed and yields default values
+    class CommandReader
+    {
+    public:
+        CommandReader(const uint8_t *begin, const uint8_t *end)
+            : mPos(begin)
+            , mEnd(end)
+            , mOk(true)
+        {
+
+        }
+
+        inline bool Ok() const { return mOk; }
+
+        template<typename T>
+        T Get() {
+            T value = T();
+            take(&value, sizeof(T));
+            return value;
+        }
+
+        template<typename T>
+        std::vector<T> GetVector() {
+            uint32_t count = Get<uint32_t>();
+            if (!mOk || uint64_t(mEnd - mPos) < uint64_t(count) * sizeof(T)) {
+                mOk = false;
+                return std::vector<T>();
+            }
+            std::vector<T> values(count);
+            take(values.data(), count * sizeof(T));
+            return values;
+        }
+
+        std::string GetString() {
+            auto chars = GetVector<char>();
+            return std::string(chars.begin(), chars.end());
+        }
+
+    private:
+        bool take(void *out, size_t size) {
+            if (!mOk || size_t(mEnd - mPos) < size) {
+                mOk = false;
+                return false;
+            }
+            if (size > 0) {
+                memcpy(out, mPos, size);
+            }
+            mPos += size;
+            return true;
+        }
+
+        const uint8_t *mPos;
+        const uint8_t *mEnd;
+        bool mOk;
+    };
+
+    static void readConfig(CommandReader &r, SceneConfig &config) {
+        // the order of CommandRecorder::putConfig
+        config.Gravity = r.Get<Vector3>();
+        config.EnablePCM = r.Get<bool>();
+        config.EnableStabilization = r.Get<bool>();
+        config.SuppressEagerRefit = r.Get<bool>();
+        config.EnableCCD = r.Get<bool>();
+        config.FrictionType = r.Get<int>();
+        config.BounceThreshold = r.Get<float>();
+        config.SolverPositionIterations = r.Get<unsigned>();
+        config.SolverVelocityIterations = r.Get<unsigned>();
+        config.SleepThreshold = r.Get<float>();
+        config.BroadPhase = r.Get<int>();
+        config.RegionSubdivisions = r.Get<unsigned>();
+        config.WorldMin = r.Get<Vector3>();
+        config.WorldMax = r.Get<Vector3>();
+        config.ThreadCount = r.Get<unsigned>();
+        config.ScratchSize = r.Get<unsigned>();
+        config.MaxActors = r.Get<unsigned>();
+        config.MaxBodies = r.Get<unsigned>();
+        config.MaxStaticShapes = r.Get<unsigned>();
+        config.MaxDynamicShapes = r.Get<unsigned>();
+        config.ThreadSafe = r.Get<bool>();
+        config.QueryOnly = r.Get<bool>();
+        config.DynamicTreeRebuildRate = r.Get<unsigned>();
+        config.EnhancedDeterminism = r.Get<bool>();
+    }
+
+    bool ReplayCommandLog(const std::string &path, unsigned threadCount, std::vector<float> &updateMs, uint64_t &stateHash) {
+        updateMs.clear();
+        stateHash = 0;
+        std::string content = GetFileContent(path);
+        CommandLogHeader header;
+        if (content.size() < sizeof(header)) {
+            ERROR("[physx] replay fail. can't read %s", path.c_str());
+            return false;
+        }
+        memcpy(&header, content.data(), sizeof(header));
+        if (header.Magic != COMMAND_LOG_MAGIC || header.Version != COMMAND_LOG_VERSION || content.size() < sizeof(header) + header.ConfigSize) {
+            ERROR("[physx] replay fail. %s is not a command log of this version", path.c_str());
+            return false;
+        }
+        const uint8_t *p = (const uint8_t*)content.data() + sizeof(header);
+        SceneConfig config;
+        CommandReader configReader(p, p + header.ConfigSize);
+        readConfig(configReader, config);
+        if (!configReader.Ok()) {
+            ERROR("[physx] replay fail. bad scene config in %s", path.c_str());
+            return false;
+        }
+        p += header.ConfigSize;
+        config.EnhancedDeterminism = true;
+        config.ThreadCount = threadCount;
+        config.ThreadSafe = false;
+
+        PhysxScene scene;
+        if (!scene.Init(config)) {
+            ERROR("[physx] replay fail. init scene");
+            return false;
+        }
+        // recorded id -> replayed id; ordered so the final hash walks actors the same way every run
+        std::map<uint64_t, uint64_t> ids;
+        auto bind = [&ids](uint64_t recorded, uint64_t replayed) {
+            if (recorded != 0 && replayed != 0) {
+                ids[recorded] = replayed;
+            }
+        };
+        auto lookup = [&ids](uint64_t recorded) -> uint64_t {
+            auto it = ids.find(recorded);
+            return it != ids.end() ? it->second : 0;
+        };
+
+        const uint8_t *end = (const uint8_t*)content.data() + content.size();
+        while (end - p >= ptrdiff_t(sizeof(uint8_t) + sizeof(uint32_t))) {
+            uint8_t op = *p++;
+            uint32_t size;
+            memcpy(&size, p, sizeof(size));
+            p += sizeof(size);
+            if (uint64_t(end - p) < size) {
+                // the room was still recording when the file was copied
+                WARNING("[physx] replay: truncated record at the end of %s", path.c_str());
+                break;
+            }
+            CommandReader r(p, p + size);
+            p += size;
+            switch (op) {
+            case eOpCreateScene: {
+                auto scenePath = r.GetString();
+                scene.CreateScene(scenePath);
+            } break;
+            case eOpUpdate: {
+                auto elapsedTime = r.Get<float>();
+                auto t1 = std::chrono::steady_clock::now();
+                scene.Update(elapsedTime);
+                auto t2 = std::chrono::steady_clock::now();
+                updateMs.push_back(std::chrono::duration<float, std::milli>(t2 - t1).count());
+            } break;
+            case eOpSetFixedTimestep: {
+                auto step = r.Get<float>();
+                auto maxSubSteps = r.Get<unsigned>();
+                scene.SetFixedTimestep(step, maxSubSteps);
+            } break;
+            case eOpCreatePlane: {
+                auto yAxis = r.Get<float>();
+                bind(r.Get<uint64_t>(), scene.CreatePlane(yAxis));
+            } break;
+            case eOpCreateHeightField: {
+                auto heightmap = r.GetVector<int16_t>();
+                auto columns = r.Get<unsigned>();
+                auto rows = r.Get<unsigned>();
+                auto scale = r.Get<Vector3>();
+                bind(r.Get<uint64_t>(), scene.CreateHeightField(heightmap, columns, rows, scale));
+            } break;
+            case eOpCreateHeightFieldMaterials: {
+                auto heightmap = r.GetVector<int16_t>();
+                auto columns = r.Get<unsigned>();
+                auto rows = r.Get<unsigned>();
+                auto scale = r.Get<Vector3>();
+                auto cellMaterials = r.GetVector<uint8_t>();
+                auto materials = r.GetVector<Material>();
+                bind(r.Get<uint64_t>(), scene.CreateHeightField(heightmap, columns, rows, scale, cellMaterials, materials));
+            } break;
+            case eOpCreateBoxDynamic:
+            case eOpCreateBoxKinematic: {
+                auto pos = r.Get<Vector3>();
+                auto halfExtents = r.Get<Vector3>();
+                auto body = r.Get<BodyDesc>();
+                auto id = op == eOpCreateBoxDynamic ? scene.CreateBoxDynamic(pos, halfExtents, body) : scene.CreateBoxKinematic(pos, halfExtents, body);
+                bind(r.Get<uint64_t>(), id);
+            } break;
+            case eOpCreateBoxStatic: {
+                auto pos = r.Get<Vector3>();
+                auto halfExtents = r.Get<Vector3>();
+                auto material = r.Get<unsigned>();
+                bind(r.Get<uint64_t>(), scene.CreateBoxStatic(pos, halfExtents, material));
+            } break;
+            case eOpCreateSphereDynamic:
+            case eOpCreateSphereKinematic: {
+                auto pos = r.Get<Vector3>();
+                auto radius = r.Get<float>();
+                auto body = r.Get<BodyDesc>();
+                auto id = op == eOpCreateSphereDynamic ? scene.CreateSphereDynamic(pos, radius, body) : scene.CreateSphereKinematic(pos, radius, body);
+                bind(r.Get<uint64_t>(), id);
+            } break;
+            case eOpCreateSphereStatic: {
+                auto pos = r.Get<Vector3>();
+                auto radius = r.Get<float>();
+                auto material = r.Get<unsigned>();
+                bind(r.Get<uint64_t>(), scene.CreateSphereStatic(pos, radius, material));
+            } break;
+            case eOpCreateCapsuleDynamic:
+            case eOpCreateCapsuleKinematic: {
+                auto pos = r.Get<Vector3>();
+                auto radius = r.Get<float>();
+                auto halfHeight = r.Get<float>();
+                auto body = r.Get<BodyDesc>();
+                auto id = op == eOpCreateCapsuleDynamic ? scene.CreateCapsuleDynamic(pos, radius, halfHeight, body) : scene.CreateCapsuleKinematic(pos, radius, halfHeight, body);
+                bind(r.Get<uint64_t>(), id);
+            } break;
+            case eOpCreateCapsuleStatic: {
+                auto pos = r.Get<Vector3>();
+                auto radius = r.Get<float>();
+                auto halfHeight = r.Get<float>();
+                auto material = r.Get<unsigned>();
+                bind(r.Get<uint64_t>(), scene.CreateCapsuleStatic(pos, radius, halfHeight, material));
+            } break;
+            case eOpCreateConvexDynamic:
+            case eOpCreateConvexKinematic: {
+                auto pos = r.Get<Vector3>();
+                auto points = r.GetVector<float>();
+                auto vertexLimit = r.Get<unsigned>();
+                auto body = r.Get<BodyDesc>();
+                auto id = op == eOpCreateConvexDynamic ? scene.CreateConvexDynamic(pos, points, vertexLimit, body) : scene.CreateConvexKinematic(pos, points, vertexLimit, body);
+                bind(r.Get<uint64_t>(), id);
+            } break;
+            case eOpCreateMeshKinematic: {
+                auto pos = r.Get<Vector3>();
+                auto scale = r.Get<Vector3>();
+                auto vb = r.GetVector<float>();
+                auto ib = r.GetVector<uint16_t>();
+                auto body = r.Get<BodyDesc>();
+                bind(r.Get<uint64_t>(), scene.CreateMeshKinematic(pos, scale, vb, ib, body));
+            } break;
+            case eOpCreateMeshStatic: {
+                auto pos = r.Get<Vector3>();
+                auto scale = r.Get<Vector3>();
+                auto vb = r.GetVector<float>();
+                auto ib = r.GetVector<uint16_t>();
+                auto material = r.Get<unsigned>();
+                bind(r.Get<uint64_t>(), scene.CreateMeshStatic(pos, scale, vb, ib, material));
+            } break;
+            case eOpCreateMeshKinematic32: {
+                auto pos = r.Get<Vector3>();
+                auto scale = r.Get<Vector3>();
+                auto vb = r.GetVector<float>();
+                auto ib = r.GetVector<uint32_t>();
+                auto body = r.Get<BodyDesc>();
+                bind(r.Get<uint64_t>(), scene.CreateMeshKinematic(pos, scale, vb, ib, body));
+            } break;
+            case eOpCreateMeshStatic32: {
+                auto pos = r.Get<Vector3>();
+                auto scale = r.Get<Vector3>();
+                auto vb = r.GetVector<float>();
+                auto ib = r.GetVector<uint32_t>();
+                auto material = r.Get<unsigned>();
+                bind(r.Get<uint64_t>(), scene.CreateMeshStatic(pos, scale, vb, ib, material));
+            } break;
+            case eOpCreateCompoundDynamic:
+            case eOpCreateCompoundKinematic: {
+                auto pos = r.Get<Vector3>();
+                auto rotate = r.Get<Quat>();
+                auto shapes = r.GetVector<ShapeDesc>();
+                auto body = r.Get<BodyDesc>();
+                auto id = op == eOpCreateCompoundDynamic ? scene.CreateCompoundDynamic(pos, rotate, shapes, body) : scene.CreateCompoundKinematic(pos, rotate, shapes, body);
+                bind(r.Get<uint64_t>(), id);
+            } break;
+            case eOpCreateCompoundStatic: {
+                auto pos = r.Get<Vector3>();
+                auto rotate = r.Get<Quat>();
+                auto shapes = r.GetVector<ShapeDesc>();
+                bind(r.Get<uint64_t>(), scene.CreateCompoundStatic(pos, rotate, shapes));
+            } break;
+            case eOpCreateAggregate: {
+                auto maxActors = r.Get<unsigned>();
+                auto selfCollision = r.Get<bool>();
+                bind(r.Get<uint64_t>(), scene.CreateAggregate(maxActors, selfCollision));
+            } break;
+            case eOpAddToAggregate: {
+                auto aggregateId = lookup(r.Get<uint64_t>());
+                auto id = lookup(r.Get<uint64_t>());
+                scene.AddToAggregate(aggregateId, id);
+            } break;
+            case eOpRemoveAggregate: {
+                auto recorded = r.Get<uint64_t>();
+                scene.RemoveAggregate(lookup(recorded));
+                ids.erase(recorded);
+            } break;
+            case eOpCreateCapsuleController: {
+                auto pos = r.Get<Vector3>();
+                auto radius = r.Get<float>();
+                auto halfHeight = r.Get<float>();
+                auto stepOffset = r.Get<float>();
+                auto slopeLimit = r.Get<float>();
+                bind(r.Get<uint64_t>(), scene.CreateCapsuleController(pos, radius, halfHeight, stepOffset, slopeLimit));
+            } break;
+            case eOpMoveControllers: {
+                auto controllers = r.GetVector<uint64_t>();
+                auto displacements = r.GetVector<Vector3>();
+                auto elapsedTime = r.Get<float>();
+                for (size_t i = 0; i < controllers.size(); i++) {
+                    controllers[i] = lookup(controllers[i]);
+                }
+                if (displacements.size() == controllers.size()) {
+                    scene.MoveControllers(controllers.data(), displacements.data(), unsigned(controllers.size()), elapsedTime);
+                }
+            } break;
+            case eOpRemoveActor: {
+                auto recorded = r.Get<uint64_t>();
+                auto id = lookup(recorded);
+                if (id != 0) {
+                    scene.RemoveActor(id);
+                    ids.erase(recorded);
+                }
+            } break;
+            case eOpSetLinearVelocity: {
+                auto id = lookup(r.Get<uint64_t>());
+                scene.SetLinearVelocity(id, r.Get<Vector3>());
+            } break;
+            case eOpAddForce: {
+                auto id = lookup(r.Get<uint64_t>());
+                scene.AddForce(id, r.Get<Vector3>());
+            } break;
+            case eOpClearForce: {
+                scene.ClearForce(lookup(r.Get<uint64_t>()));
+            } break;
+            case eOpSetGlobalPostion: {
+                auto id = lookup(r.Get<uint64_t>());
+                scene.SetGlobalPostion(id, r.Get<Vector3>());
+            } break;
+            case eOpSetGlobalRotate: {
+                auto id = lookup(r.Get<uint64_t>());
+                scene.SetGlobalRotate(id, r.Get<Quat>());
+            } break;
+            case eOpSetTrigger: {
+                auto id = lookup(r.Get<uint64_t>());
+                auto trigger = r.Get<bool>();
+                if (id != 0) {
+                    scene.SetTrigger(id, trigger);
+                }
+            } break;
+            case eOpEnableContactEvents: {
+                auto id = lookup(r.Get<uint64_t>());
+                auto enable = r.Get<bool>();
+                if (id != 0) {
+                    scene.EnableContactEvents(id, enable);
+                }
+            } break;
+            case eOpCreateMaterial: {
+                auto staticFriction = r.Get<float>();
+                auto dynamicFriction = r.Get<float>();
+                auto restitution = r.Get<float>();
+                scene.CreateMaterial(staticFriction, dynamicFriction, restitution);
+            } break;
+            case eOpSetCurrentMaterialIndex: {
+                scene.SetCurrentMaterial(r.Get<unsigned>());
+            } break;
+            case eOpSetCurrentMaterial: {
+                auto staticFriction = r.Get<float>();
+                auto dynamicFriction = r.Get<float>();
+                auto restitution = r.Get<float>();
+                scene.SetCurrentMaterial(staticFriction, dynamicFriction, restitution);
+            } break;
+            case eOpSetCurrentAngularDamping: {
+                scene.SetCurrentAngularDamping(r.Get<float>());
+            } break;
+            case eOpEnableHistory: {
+                scene.EnableHistory(r.Get<unsigned>());
+            } break;
+            case eOpEnableInterest: {
+                scene.EnableInterest(r.Get<float>());
+            } break;
+            case eOpUnrecorded: {
+                auto call = r.GetString();
+                ERROR("[physx] replay fail. the room called %s while recording %s", call.c_str(), path.c_str());
+                return false;
+            }
+            default:
+                ERROR("[physx] replay fail. unknown op %u in %s", unsigned(op), path.c_str());
+                return false;
+            }
+            if (!r.Ok()) {
+                ERROR("[physx] replay fail. bad payload for op %u in %s", unsigned(op), path.c_str());
+                return false;
+            }
+        }
+
+        // ids differ between runs, so the hash covers poses only, in recorded id order
+        uint64_t hash = HashBytes(nullptr, 0);
+        for (auto it = ids.begin(); it != ids.end(); ++it) {
+            if (!scene.IsDynamicObj(it->second)) {
+                continue;
+            }
+            Vector3 pos = scene.GetGlobalPostion(it->second);
+            Quat rotate = scene.GetGlobalRotate(it->second);
+            hash = HashBytes(&pos, sizeof(pos), hash);
+            hash = HashBytes(&rotate, sizeof(rotate), hash);
+        }
+        stateHash = hash;
+        return true;
+    }
+
+}
@@ -0,0 +1,125 @@
+#ifndef __COMMAND_LOG_H__
+#define __COMMAND_LOG_H__
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../PhysxWrap.h"
+
+namespace PhysxWrap {
+
+    // one record per PhysxScene call: op, payload size, payload (arguments in call order, then the created id if any)
+    enum CommandOp : uint8_t {
+        eOpCreateScene = 1,
+        eOpUpdate,
+        eOpSetFixedTimestep,
+        eOpCreatePlane,
+        eOpCreateHeightField,
+        eOpCreateHeightFieldMaterials,
+        eOpCreateBoxDynamic,
+        eOpCreateBoxKinematic,
+        eOpCreateBoxStatic,
+        eOpCreateSphereDynamic,
+        eOpCreateSphereKinematic,
+        eOpCreateSphereStatic,
+        eOpCreateCapsuleDynamic,
+        eOpCreateCapsuleKinematic,
+        eOpCreateCapsuleStatic,
+        eOpCreateConvexDynamic,
+        eOpCreateConvexKinematic,
+        eOpCreateMeshKinematic,
+        eOpCreateMeshStatic,
+        eOpCreateMeshKinematic32,
+        eOpCreateMeshStatic32,
+        eOpCreateCompoundDynamic,
+        eOpCreateCompoundKinematic,
+        eOpCreateCompoundStatic,
+        eOpCreateAggregate,
+        eOpAddToAggregate,
+        eOpRemoveAggregate,
+        eOpCreateCapsuleController,
+        eOpMoveControllers,
+        eOpRemoveActor,
+        eOpSetLinearVelocity,
+        eOpAddForce,
+        eOpClearForce,
+        eOpSetGlobalPostion,
+        eOpSetGlobalRotate,
+        eOpSetTrigger,
+        eOpEnableContactEvents,
+        eOpCreateMaterial,
+        eOpSetCurrentMaterialIndex,
+        eOpSetCurrentMaterial,
+        eOpSetCurrentAngularDamping,
+        eOpEnableHistory,
+        eOpEnableInterest,
+        eOpUnrecorded,      // a state-changing call the log can't express: the log ends here and replays fail
+    };
+
+    // appends PhysxScene calls to a file. Write may be called from any thread
+    class CommandRecorder
+    {
+    public:
+        CommandRecorder();
+        ~CommandRecorder();
+
+        bool Open(const std::string &path, const SceneConfig &config);
+        void Close();
+        // `call` changed the room without a record: marks the log unreplayable and stops recording
+        void Invalidate(const char *call);
+
+        template<typename... Args>
+        void Write(CommandOp op, const Args&... args) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mFile == nullptr) {
+                return;
+            }
+            mPayload.clear();
+            append(args...);
+            writeRecord(op);
+        }
+
+    private:
+        void append() {}
+
+        template<typename T, typename... Rest>
+        void append(const T &value, const Rest&... rest) {
+            put(value);
+            append(rest...);
+        }
+
+        template<typename T>
+        void put(const T &value) {
+            auto bytes = (const uint8_t*)&value;
+            mPayload.insert(mPayload.end(), bytes, bytes + sizeof(T));
+        }
+
+        template<typename T>
+        void put(const std::vector<T> &values) {
+            put(uint32_t(values.size()));
+            auto bytes = (const uint8_t*)values.data();
+            mPayload.insert(mPayload.end(), bytes, bytes + values.size() * sizeof(T));
+        }
+
+        void put(const std::string &value) {
+            put(uint32_t(value.size()));
+            mPayload.insert(mPayload.end(), value.begin(), value.end());
+        }
+
+        void putConfig(const SceneConfig &config);
+        void writeRecord(CommandOp op);
+
+        std::mutex mMutex;
+        FILE* mFile;
+        std::vector<uint8_t> mPayload;  // reused between records
+    };
+
+    // re-runs a log on a new room with enhanced determinism and `threadCount` dispatcher threads.
+    // updateMs receives the cost of every Update; stateHash a hash of the final dynamic state
+    bool ReplayCommandLog(const std::string &path, unsigned threadCount, std::vector<float> &updateMs, uint64_t &stateHash);
+
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "interest_grid.h"
+#include <cmath>
+
+#define MAX_CELL_COORD (1 << 30)
+
+namespace PhysxWrap {
+
+    InterestGrid::InterestGrid()
+        : mCellSize(0.0f)
+        , mInvCellSize(0.0f)
+    {
+
+    }
+
+    void InterestGrid::Reset(float cellSize) {
+        mCells.clear();
+        mEntries.clear();
+        mCellSize = cellSize > 0.0f ? cellSize : 0.0f;
+        mInvCellSize = cellSize > 0.0f ? 1.0f / cellSize : 0.0f;
+    }
+
+    uint64_t InterestGrid::cellKey(int cx, int cz) const {
+        return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cz);
+    }
+
+    int InterestGrid::cellCoord(float v) const {
+        float c = std::floor(v * mInvCellSize);
+        // NaN and far away positions share the border cells
+        if (!(c > -MAX_CELL_COORD)) {
+            return -MAX_CELL_COORD;
+        }
+        return c < MAX_CELL_COORD ? int(c) : MAX_CELL_COORD;
+    }
+
+    void InterestGrid::Update(uint64_t id, float x, float z) {
+        uint64_t key = cellKey(cellCoord(x), cellCoord(z));
+        auto it = mEntries.find(id);
+        if (it != mEntries.end()) {
+            if (it->second.Cell == key) {
+                auto &item = mCells[key][it->second.Slot];
+                item.X = x;
+                item.Z = z;
+                return;
+            }
+            Remove(id);
+        }
+        auto &items = mCells[key];
+        mEntries[id] = Entry{ key, unsigned(items.size()) };
+        items.push_back(Item{ id, x, z });
+    }
+
+    void InterestGrid::Remove(uint64_t id) {
+        auto it = mEntries.find(id);
+        if (it == mEntries.end()) {
+            return;
+        }
+        auto cell = mCells.find(it->second.Cell);
+        auto &items = cell->second;
+        unsigned slot = it->second.Slot;
+        if (slot + 1 < items.size()) {
+            items[slot] = items.back();
+            mEntries[items[slot].Id].Slot = slot;
+        }
+        items.pop_back();
+        if (items.empty()) {
+            mCells.erase(cell);
+        }
+        mEntries.erase(it);
+    }
+
+    void InterestGrid::collect(const std::vector<Item> &items, const Vector3 &observer, float radiusSq, std::vector<uint64_t> &ids) {
+        for (size_t i = 0; i < items.size(); i++) {
+            float dx = items[i].X - observer.X;
+            float dz = items[i].Z - observer.Z;
+            if (dx * dx + dz * dz <= radiusSq) {
+                ids.push_back(items[i].Id);
+            }
+        }
+    }
+
+    void InterestGrid::Query(const Vector3 *observers, unsigned count, float radius, std::vector<uint64_t> &ids, std::vector<unsigned> &offsets) const {
+        ids.clear();
+        offsets.resize(count + 1);
+        float radiusSq = radius * radius;
+        for (unsigned i = 0; i < count; i++) {
+            offsets[i] = unsigned(ids.size());
+            if (!Enabled() || mCells.empty()) {
+                continue;
+            }
+            const Vector3 &o = observers[i];
+            int minX = cellCoord(o.X - radius), maxX = cellCoord(o.X + radius);
+            int minZ = cellCoord(o.Z - radius), maxZ = cellCoord(o.Z + radius);
+            if (uint64_t(int64_t(maxX) - minX + 1) * uint64_t(int64_t(maxZ) - minZ + 1) > mCells.size()) {
+                // radius spans more cells than are occupied
+                for (auto cell = mCells.begin(); cell != mCells.end(); ++cell) {
+                    collect(cell->second, o, radiusSq, ids);
+                }
+                continue;
+            }
+            for (int cx = minX; cx <= maxX; cx++) {
+                for (int cz = minZ; cz <= maxZ; cz++) {
+                    auto cell = mCells.find(cellKey(cx, cz));
+                    if (cell != mCells.end()) {
+                        collect(cell->second, o, radiusSq, ids);
+                    }
+                }
+            }
+        }
+        offsets[count] = unsigned(ids.size());
+    }
+
+}
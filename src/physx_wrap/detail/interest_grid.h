@@ -0,0 +1,51 @@
+#ifndef __INTEREST_GRID_H__
+#define __INTEREST_GRID_H__
+
+#include <vector>
+#include <unordered_map>
+#include "../PhysxWrap.h"
+
+namespace PhysxWrap {
+
+    // area of interest index: actor positions bucketed in a uniform grid over the horizontal (XZ) plane.
+    // Updated incrementally with the actors that moved; not locked, the owning scene serializes access.
+    class InterestGrid
+    {
+    public:
+        InterestGrid();
+
+        // 0 disables and drops every entry
+        void Reset(float cellSize);
+        inline bool Enabled() const { return mCellSize > 0.0f; }
+
+        void Update(uint64_t id, float x, float z);
+        void Remove(uint64_t id);
+
+        // ids within horizontal `radius` of each observer: those of observer i are ids[offsets[i]] .. ids[offsets[i + 1] - 1]
+        void Query(const Vector3 *observers, unsigned count, float radius, std::vector<uint64_t> &ids, std::vector<unsigned> &offsets) const;
+
+    private:
+        struct Item {
+            uint64_t Id;
+            float X;
+            float Z;
+        };
+
+        struct Entry {
+            uint64_t Cell;
+            unsigned Slot;      // index in the cell's item list
+        };
+
+        uint64_t cellKey(int cx, int cz) const;
+        int cellCoord(float v) const;
+        static void collect(const std::vector<Item> &items, const Vector3 &observer, float radiusSq, std::vector<uint64_t> &ids);
+
+        float mCellSize;
+        float mInvCellSize;
+        std::unordered_map<uint64_t, std::vector<Item>> mCells;
+        std::unordered_map<uint64_t, Entry> mEntries;
+    };
+
+};
+
+#endif
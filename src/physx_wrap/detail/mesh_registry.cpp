@@ -0,0 +1,209 @@
+#include "mesh_registry.h"
+#include "physx_sdk.h"
+#include "util.h"
+#include "log.h"
+
+namespace PhysxWrap {
+
+    MeshRegistry __gMeshRegistry;
+    MeshRegistry* gMeshRegistry = &__gMeshRegistry;
+
+    MeshRegistry::MeshRegistry()
+        : mCookedBytes(0)
+        , mNextId(1)
+    {
+
+    }
+
+    // ReleasePhysxSDK clears the registry. At static destruction the SDK may already be gone, so nothing is released here
+    MeshRegistry::~MeshRegistry() {
+
+    }
+
+    uint64_t MeshRegistry::Register(const std::vector<float> &vb, const std::vector<uint16_t> &ib) {
+        return registerMesh(vb, ib, nullptr);
+    }
+
+    uint64_t MeshRegistry::Register(const std::vector<float> &vb, const std::vector<uint32_t> &ib) {
+        return registerMesh(vb, ib, nullptr);
+    }
+
+    uint64_t MeshRegistry::Register(const std::vector<float> &vb, const std::vector<uint16_t> &ib, const MeshCookingConfig *config) {
+        return registerMesh(vb, ib, config);
+    }
+
+    uint64_t MeshRegistry::Register(const std::vector<float> &vb, const std::vector<uint32_t> &ib, const MeshCookingConfig *config) {
+        return registerMesh(vb, ib, config);
+    }
+
+    static void appendBytes(std::vector<uint8_t> &out, const void *data, size_t size) {
+        auto p = (const uint8_t*)data;
+        out.insert(out.end(), p, p + size);
+    }
+
+    static void appendConfig(std::vector<uint8_t> &out, const MeshCookingConfig &config) {
+        // field by field, the struct has padding
+        appendBytes(out, &config.WeldTolerance, sizeof(config.WeldTolerance));
+        appendBytes(out, &config.Midphase, sizeof(config.Midphase));
+        appendBytes(out, &config.CookingHint, sizeof(config.CookingHint));
+        appendBytes(out, &config.SizePerformanceTradeOff, sizeof(config.SizePerformanceTradeOff));
+        appendBytes(out, &config.TrisPerLeaf, sizeof(config.TrisPerLeaf));
+        appendBytes(out, &config.SuppressRemapTable, sizeof(config.SuppressRemapTable));
+        appendBytes(out, &config.DisableActiveEdges, sizeof(config.DisableActiveEdges));
+    }
+
+    // the lengths go first so the same byte stream split differently between vb and ib is another mesh
+    template<typename T>
+    static std::vector<uint8_t> meshSource(const std::vector<float> &vb, const std::vector<T> &ib, const MeshCookingConfig &config) {
+        uint64_t header[3] = { vb.size(), ib.size(), sizeof(T) };
+        std::vector<uint8_t> source;
+        source.reserve(sizeof(header) + vb.size() * sizeof(float) + ib.size() * sizeof(T) + sizeof(MeshCookingConfig));
+        appendBytes(source, header, sizeof(header));
+        appendBytes(source, vb.data(), vb.size() * sizeof(float));
+        appendBytes(source, ib.data(), ib.size() * sizeof(T));
+        appendConfig(source, config);
+        return source;
+    }
+
+    uint64_t MeshRegistry::findMesh(uint64_t hash, const std::vector<uint8_t> &source) {
+        auto range = mHashToId.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (mMeshes[it->second].Source == source) {
+                return it->second;
+            }
+        }
+        return 0;
+    }
+
+    physx::PxConvexMesh* MeshRegistry::findConvex(uint64_t hash, const std::vector<uint8_t> &source) {
+        auto range = mConvexes.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.Source == source) {
+                return it->second.Mesh;
+            }
+        }
+        return nullptr;
+    }
+
+    template<typename T>
+    uint64_t MeshRegistry::registerMesh(const std::vector<float> &vb, const std::vector<T> &ib, const MeshCookingConfig *config) {
+        // key and cook with the effective config: the global one may change between registrations
+        MeshCookingConfig effective = config ? *config : gPhysxSDKImpl->GetMeshCookingConfig();
+        std::vector<uint8_t> source = meshSource(vb, ib, effective);
+        uint64_t hash = HashBytes(source.data(), source.size());
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            uint64_t meshId = findMesh(hash, source);
+            if (meshId) {
+                mMeshes[meshId].Refs++;
+                return meshId;
+            }
+        }
+
+        // cook unlocked, a large mesh must not stall every other registration and lookup
+        size_t bytes = 0;
+        physx::PxTriangleMesh* mesh = CookTriangleMesh(vb, ib, &effective, &bytes);
+        if (!mesh) {
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        uint64_t meshId = findMesh(hash, source);
+        if (meshId) {
+            // another thread cooked the same data meanwhile
+            mesh->release();
+            mMeshes[meshId].Refs++;
+            return meshId;
+        }
+        meshId = mNextId++;
+        mMeshes[meshId] = Entry{ mesh, hash, 1, bytes, std::move(source) };
+        mCookedBytes += bytes;
+        mHashToId.insert(std::make_pair(hash, meshId));
+        return meshId;
+    }
+
+    void MeshRegistry::Unregister(uint64_t meshId) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mMeshes.find(meshId);
+        if (it == mMeshes.end()) {
+            return;
+        }
+        if (--it->second.Refs == 0) {
+            if (gPhysxSDKImpl->IsInit()) {
+                it->second.Mesh->release();
+            }
+            mCookedBytes -= it->second.Bytes;
+            auto range = mHashToId.equal_range(it->second.Hash);
+            for (auto hit = range.first; hit != range.second; ++hit) {
+                if (hit->second == meshId) {
+                    mHashToId.erase(hit);
+                    break;
+                }
+            }
+            mMeshes.erase(it);
+        }
+    }
+
+    physx::PxTriangleMesh* MeshRegistry::Get(uint64_t meshId) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mMeshes.find(meshId);
+        return it != mMeshes.end() ? it->second.Mesh : nullptr;
+    }
+
+    physx::PxConvexMesh* MeshRegistry::GetConvex(const std::vector<float> &points, unsigned vertexLimit) {
+        uint64_t header[2] = { vertexLimit, points.size() };
+        std::vector<uint8_t> source;
+        appendBytes(source, header, sizeof(header));
+        appendBytes(source, points.data(), points.size() * sizeof(float));
+        uint64_t hash = HashBytes(source.data(), source.size());
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            physx::PxConvexMesh* convex = findConvex(hash, source);
+            if (convex) {
+                return convex;
+            }
+        }
+
+        physx::PxConvexMesh* convex = CookConvexMesh(points, vertexLimit);
+        if (!convex) {
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        physx::PxConvexMesh* cached = findConvex(hash, source);
+        if (cached) {
+            convex->release();
+            return cached;
+        }
+        mConvexes.insert(std::make_pair(hash, ConvexEntry{ convex, std::move(source) }));
+        return convex;
+    }
+
+    uint64_t MeshRegistry::GetCookedBytes() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCookedBytes;
+    }
+
+    uint64_t MeshRegistry::GetCookedBytes(uint64_t meshId) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mMeshes.find(meshId);
+        return it != mMeshes.end() ? it->second.Bytes : 0;
+    }
+
+    void MeshRegistry::Clear() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (gPhysxSDKImpl->IsInit()) {
+            for (auto it = mMeshes.begin(); it != mMeshes.end(); ++it) {
+                it->second.Mesh->release();
+            }
+            for (auto it = mConvexes.begin(); it != mConvexes.end(); ++it) {
+                it->second.Mesh->release();
+            }
+        }
+        mMeshes.clear();
+        mHashToId.clear();
+        mCookedBytes = 0;
+        mConvexes.clear();
+    }
+
+}
@@ -0,0 +1,67 @@
+#ifndef __MESH_REGISTRY_H__
+#define __MESH_REGISTRY_H__
+
+#include <PxPhysics.h>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include "../PhysxWrap.h"
+
+namespace PhysxWrap {
+
+    // process-wide cooked triangle meshes, deduplicated by content and shared by all rooms.
+    // Each Register takes one reference; shapes keep their own PhysX reference on the mesh.
+    // Convex hulls are cached by content until Clear.
+    // Cooking runs outside the registry lock, a hash hit is only trusted once the source bytes match.
+    class MeshRegistry
+    {
+    public:
+        MeshRegistry();
+        ~MeshRegistry();
+
+        uint64_t Register(const std::vector<float> &vb, const std::vector<uint16_t> &ib);
+        uint64_t Register(const std::vector<float> &vb, const std::vector<uint32_t> &ib);
+        // config == nullptr cooks with the global config at the time of the call
+        uint64_t Register(const std::vector<float> &vb, const std::vector<uint16_t> &ib, const MeshCookingConfig *config);
+        uint64_t Register(const std::vector<float> &vb, const std::vector<uint32_t> &ib, const MeshCookingConfig *config);
+        void Unregister(uint64_t meshId);
+        physx::PxTriangleMesh* Get(uint64_t meshId);
+        physx::PxConvexMesh* GetConvex(const std::vector<float> &points, unsigned vertexLimit);
+        uint64_t GetCookedBytes();
+        // cooked size of one registered mesh, 0 if unknown
+        uint64_t GetCookedBytes(uint64_t meshId);
+        void Clear();
+
+    private:
+        template<typename T>
+        uint64_t registerMesh(const std::vector<float> &vb, const std::vector<T> &ib, const MeshCookingConfig *config);
+        // 0 if no registered mesh was cooked from `source`; mMutex held by the caller
+        uint64_t findMesh(uint64_t hash, const std::vector<uint8_t> &source);
+        physx::PxConvexMesh* findConvex(uint64_t hash, const std::vector<uint8_t> &source);
+
+        struct Entry {
+            physx::PxTriangleMesh* Mesh;
+            uint64_t Hash;
+            unsigned Refs;
+            size_t Bytes;
+            std::vector<uint8_t> Source;    // lengths, vertices, indices and cooking config the mesh was cooked from
+        };
+
+        struct ConvexEntry {
+            physx::PxConvexMesh* Mesh;
+            std::vector<uint8_t> Source;
+        };
+
+        std::mutex mMutex;
+        uint64_t mCookedBytes;
+        std::unordered_multimap<uint64_t, uint64_t> mHashToId;
+        std::unordered_map<uint64_t, Entry> mMeshes;
+        uint64_t mNextId;
+        std::unordered_multimap<uint64_t, ConvexEntry> mConvexes;
+    };
+
+    extern MeshRegistry* gMeshRegistry;
+
+};
+
+#endif
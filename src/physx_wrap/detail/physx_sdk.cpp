@@ -45,6 +45,7 @@ namespace PhysxWrap {
 #endif
             physx::PxTolerancesScale scale;
             customizeTolerances(scale);
+            mTolerancesScale = scale;
             mPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *mFoundation, scale, false, mPVD.GetPvdInstance());
             if (!mPhysicsSDK) {
                 ERROR("[physx] PxCreatePhysics failed!");
@@ -59,10 +60,8 @@ namespace PhysxWrap {
             }
 #endif
 
-            physx::PxCookingParams params(scale);
-            //params.meshWeldTolerance = 0.001f;
-            //params.meshPreprocessParams = physx::PxMeshPreprocessingFlags(physx::PxMeshPreprocessingFlag::eWELD_VERTICES);
-            mCooking = PxCreateCooking(PX_PHYSICS_VERSION, *mFoundation, params);
+            std::lock_guard<std::mutex> lock(mCookingMutex);
+            mCooking = PxCreateCooking(PX_PHYSICS_VERSION, *mFoundation, makeCookingParams(mMeshCookingConfig));
             if (!mCooking) {
                 ERROR("[physx] PxCreateCooking failed!");
                 release();
@@ -73,6 +72,47 @@ namespace PhysxWrap {
         return true;
     }
 
+    physx::PxCookingParams PhysxSDKImpl::makeCookingParams(const MeshCookingConfig &config) {
+        physx::PxCookingParams params(mTolerancesScale);
+        params.convexMeshCookingType = physx::PxConvexMeshCookingType::eQUICKHULL;
+        if (config.WeldTolerance > 0.0f) {
+            params.meshWeldTolerance = config.WeldTolerance;
+            params.meshPreprocessParams |= physx::PxMeshPreprocessingFlag::eWELD_VERTICES;
+        }
+        if (config.DisableActiveEdges) {
+            params.meshPreprocessParams |= physx::PxMeshPreprocessingFlag::eDISABLE_ACTIVE_EDGES_PRECOMPUTE;
+        }
+        params.suppressTriangleMeshRemapTable = config.SuppressRemapTable;
+        if (config.Midphase == eMidphaseBVH34) {
+            params.midphaseDesc.setToDefault(physx::PxMeshMidPhase::eBVH34);
+            params.midphaseDesc.mBVH34Desc.numTrisPerLeaf = physx::PxClamp(config.TrisPerLeaf, 4u, 15u);
+        }
+        else {
+            params.midphaseDesc.setToDefault(physx::PxMeshMidPhase::eBVH33);
+            params.midphaseDesc.mBVH33Desc.meshCookingHint = config.CookingHint == eHintCookingPerformance
+                ? physx::PxMeshCookingHint::eCOOKING_PERFORMANCE : physx::PxMeshCookingHint::eSIM_PERFORMANCE;
+            params.midphaseDesc.mBVH33Desc.meshSizePerformanceTradeOff = physx::PxClamp(config.SizePerformanceTradeOff, 0.0f, 1.0f);
+        }
+        return params;
+    }
+
+    void PhysxSDKImpl::ApplyCookingConfig(const MeshCookingConfig *config) {
+        mCooking->setParams(makeCookingParams(config ? *config : mMeshCookingConfig));
+    }
+
+    void PhysxSDKImpl::SetMeshCookingConfig(const MeshCookingConfig &config) {
+        std::lock_guard<std::mutex> lock(mCookingMutex);
+        mMeshCookingConfig = config;
+        if (mCooking) {
+            mCooking->setParams(makeCookingParams(mMeshCookingConfig));
+        }
+    }
+
+    MeshCookingConfig PhysxSDKImpl::GetMeshCookingConfig() {
+        std::lock_guard<std::mutex> lock(mCookingMutex);
+        return mMeshCookingConfig;
+    }
+
     void PhysxSDKImpl::release() {
         bool exp = true;
         if (mInit.compare_exchange_strong(exp, false)) {
@@ -87,7 +127,11 @@ namespace PhysxWrap {
     }
 
 
-    bool GetHeightFieldGeometry(physx::PxHeightFieldGeometry &geom, const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale) {
+    bool GetHeightFieldGeometry(physx::PxHeightFieldGeometry &geom, const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale, const std::vector<uint8_t> *cellMaterials) {
+        if (cellMaterials && cellMaterials->size() != size_t(rows - 1) * (columns - 1)) {
+            ERROR("[physx] heightfield cell materials size mismatch. %u != %u", unsigned(cellMaterials->size()), (rows - 1) * (columns - 1));
+            return false;
+        }
         unsigned hfNumVerts = columns*rows;
         physx::PxHeightFieldSample* samples = (physx::PxHeightFieldSample*)malloc(sizeof(physx::PxHeightFieldSample)*hfNumVerts);
         memset(samples, 0, hfNumVerts * sizeof(physx::PxHeightFieldSample));
@@ -97,9 +141,12 @@ namespace PhysxWrap {
             {
                 int index = col + row*columns;
                 samples[index].height = heightmap[index];
-                //samples[index].setTessFlag();
-                //samples[index].materialIndex0 = 1;
-                //samples[index].materialIndex1 = 1;
+                // a sample carries the materials of the cell it is the first corner of
+                if (cellMaterials && row + 1 < rows && col + 1 < columns) {
+                    uint8_t material = (*cellMaterials)[col + row*(columns - 1)];
+                    samples[index].materialIndex0 = material;
+                    samples[index].materialIndex1 = material;
+                }
             }
 
         physx::PxHeightFieldDesc hfDesc;
@@ -109,7 +156,11 @@ namespace PhysxWrap {
         hfDesc.samples.data = samples;
         hfDesc.samples.stride = sizeof(physx::PxHeightFieldSample);
 
-        physx::PxHeightField* heightField = gPhysxSDKImpl->GetCooking()->createHeightField(hfDesc, gPhysxSDKImpl->GetPhysics()->getPhysicsInsertionCallback());
+        physx::PxHeightField* heightField = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(gPhysxSDKImpl->GetCookingMutex());
+            heightField = gPhysxSDKImpl->GetCooking()->createHeightField(hfDesc, gPhysxSDKImpl->GetPhysics()->getPhysicsInsertionCallback());
+        }
         if (!heightField) {
             ERROR("[physx] creating the heightfield failed");
             free(samples);
@@ -124,36 +175,98 @@ namespace PhysxWrap {
     }
 
 
+    template<typename T>
+    static bool getMeshGeometry(physx::PxTriangleMeshGeometry& geom, const Vector3 &scale, const std::vector<float> &vb, const std::vector<T> &ib) {
+        physx::PxTriangleMesh* triangleMesh = CookTriangleMesh(vb, ib);
+        if (triangleMesh) {
+            physx::PxMeshScale meshScale = physx::PxMeshScale(physx::PxVec3{ scale.X ,scale.Y ,scale.Z }, physx::PxQuat(physx::PxIdentity));
+            geom.triangleMesh = triangleMesh;
+            geom.scale = meshScale;
+            return true;
+        }
+        return false;
+    }
+
     bool GetMeshGeometry(physx::PxTriangleMeshGeometry& geom, const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib) {
+        return getMeshGeometry(geom, scale, vb, ib);
+    }
+
+    bool GetMeshGeometry(physx::PxTriangleMeshGeometry& geom, const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib) {
+        return getMeshGeometry(geom, scale, vb, ib);
+    }
+
+    static physx::PxTriangleMesh* cookTriangleMesh(const std::vector<float> &vb, const void* indices, size_t count, bool indices16, const MeshCookingConfig *config, size_t *cookedBytes) {
         physx::PxTriangleMeshDesc meshDesc;
         meshDesc.points.count = physx::PxU32(vb.size() / 3);
-        meshDesc.triangles.count = physx::PxU32(ib.size() / 3);
+        meshDesc.triangles.count = physx::PxU32(count / 3);
         meshDesc.points.stride = sizeof(float) * 3;
-        meshDesc.triangles.stride = sizeof(uint16_t) * 3;
+        meshDesc.triangles.stride = (indices16 ? sizeof(uint16_t) : sizeof(uint32_t)) * 3;
         meshDesc.points.data = vb.data();
-        meshDesc.triangles.data = ib.data();
-        meshDesc.flags |= physx::PxMeshFlag::e16_BIT_INDICES;
+        meshDesc.triangles.data = indices;
+        if (indices16) {
+            meshDesc.flags |= physx::PxMeshFlag::e16_BIT_INDICES;
+        }
         meshDesc.flags |= physx::PxMeshFlag::eFLIPNORMALS;
 
         physx::PxDefaultMemoryOutputStream streamout;
-        bool ok = gPhysxSDKImpl->GetCooking()->cookTriangleMesh(meshDesc, streamout);
-        if (!ok) {
-            ERROR("[physx] cookTriangleMesh fail.");
-            return false;
+        {
+            std::lock_guard<std::mutex> lock(gPhysxSDKImpl->GetCookingMutex());
+            if (config) {
+                gPhysxSDKImpl->ApplyCookingConfig(config);
+            }
+            bool ok = gPhysxSDKImpl->GetCooking()->cookTriangleMesh(meshDesc, streamout);
+            if (config) {
+                gPhysxSDKImpl->ApplyCookingConfig(nullptr);
+            }
+            if (!ok) {
+                ERROR("[physx] cookTriangleMesh fail.");
+                return nullptr;
+            }
+        }
+        if (cookedBytes) {
+            *cookedBytes = streamout.getSize();
         }
 
         physx::PxDefaultMemoryInputData streamin(streamout.getData(), streamout.getSize());
         physx::PxTriangleMesh* triangleMesh = gPhysxSDKImpl->GetPhysics()->createTriangleMesh(streamin);
-        if (triangleMesh) {
-            physx::PxMeshScale meshScale = physx::PxMeshScale(physx::PxVec3{ scale.X ,scale.Y ,scale.Z }, physx::PxQuat(physx::PxIdentity));
-            geom.triangleMesh = triangleMesh;
-            geom.scale = meshScale;
-            return true;
-        }
-        else {
+        if (!triangleMesh) {
             ERROR("[physx] createTriangleMesh fail.");
-            return false;
         }
+        return triangleMesh;
+    }
+
+    physx::PxTriangleMesh* CookTriangleMesh(const std::vector<float> &vb, const std::vector<uint16_t> &ib, const MeshCookingConfig *config, size_t *cookedBytes) {
+        return cookTriangleMesh(vb, ib.data(), ib.size(), true, config, cookedBytes);
+    }
+
+    physx::PxTriangleMesh* CookTriangleMesh(const std::vector<float> &vb, const std::vector<uint32_t> &ib, const MeshCookingConfig *config, size_t *cookedBytes) {
+        return cookTriangleMesh(vb, ib.data(), ib.size(), false, config, cookedBytes);
+    }
+
+    physx::PxConvexMesh* CookConvexMesh(const std::vector<float> &points, unsigned vertexLimit) {
+        physx::PxConvexMeshDesc convexDesc;
+        convexDesc.points.count = physx::PxU32(points.size() / 3);
+        convexDesc.points.stride = sizeof(float) * 3;
+        convexDesc.points.data = points.data();
+        convexDesc.flags = physx::PxConvexFlag::eCOMPUTE_CONVEX;
+        convexDesc.vertexLimit = physx::PxU16(physx::PxClamp(vertexLimit, 4u, 255u));
+
+        physx::PxDefaultMemoryOutputStream streamout;
+        {
+            std::lock_guard<std::mutex> lock(gPhysxSDKImpl->GetCookingMutex());
+            bool ok = gPhysxSDKImpl->GetCooking()->cookConvexMesh(convexDesc, streamout);
+            if (!ok) {
+                ERROR("[physx] cookConvexMesh fail.");
+                return nullptr;
+            }
+        }
+
+        physx::PxDefaultMemoryInputData streamin(streamout.getData(), streamout.getSize());
+        physx::PxConvexMesh* convexMesh = gPhysxSDKImpl->GetPhysics()->createConvexMesh(streamin);
+        if (!convexMesh) {
+            ERROR("[physx] createConvexMesh fail.");
+        }
+        return convexMesh;
     }
 
 }
@@ -10,6 +10,7 @@
 #include <geometry/PxHeightField.h>
 #include <geometry/PxConvexMeshGeometry.h>
 #include <atomic>
+#include <mutex>
 #include <vector>
 #include "physx_pvd.h"
 #include "physx_sdk.h"
@@ -24,28 +25,46 @@ namespace PhysxWrap {
 
         bool Init();
         inline  void Release() { release(); }
+        inline bool IsInit() { return mInit.load(); }
 
         inline physx::PxFoundation* GetFoundation() { return mFoundation; }
         inline physx::PxPhysics* GetPhysics() { return mPhysicsSDK; }
         inline physx::PxCooking* GetCooking() { return mCooking; }
         inline PhysxPVD &GetPVD() { return mPVD; }
+        // every cooking call holds this lock, so params can be switched safely
+        inline std::mutex &GetCookingMutex() { return mCookingMutex; }
+
+        void SetMeshCookingConfig(const MeshCookingConfig &config);
+        MeshCookingConfig GetMeshCookingConfig();
+        // caller holds GetCookingMutex(); nullptr switches back to the global config
+        void ApplyCookingConfig(const MeshCookingConfig *config);
 
     protected:
         virtual void customizeTolerances(physx::PxTolerancesScale&) {}
 
     private:
         void release();
+        physx::PxCookingParams makeCookingParams(const MeshCookingConfig &config);
 
         std::atomic_bool mInit;
         physx::PxFoundation* mFoundation;
         physx::PxPhysics* mPhysicsSDK;
         physx::PxCooking* mCooking;
         PhysxPVD mPVD;
+        physx::PxTolerancesScale mTolerancesScale;
+        MeshCookingConfig mMeshCookingConfig;
+        std::mutex mCookingMutex;
     };
 
 
-    bool GetHeightFieldGeometry(physx::PxHeightFieldGeometry &geom, const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale);
+    // cellMaterials: (rows - 1) * (columns - 1) shape material indices, eTerrainHole cuts the cell out
+    bool GetHeightFieldGeometry(physx::PxHeightFieldGeometry &geom, const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale, const std::vector<uint8_t> *cellMaterials = nullptr);
     bool GetMeshGeometry(physx::PxTriangleMeshGeometry& geom, const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib);
+    bool GetMeshGeometry(physx::PxTriangleMeshGeometry& geom, const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib);
+    // config == nullptr uses the global config; cookedBytes receives the size of the cooked data
+    physx::PxTriangleMesh* CookTriangleMesh(const std::vector<float> &vb, const std::vector<uint16_t> &ib, const MeshCookingConfig *config = nullptr, size_t *cookedBytes = nullptr);
+    physx::PxTriangleMesh* CookTriangleMesh(const std::vector<float> &vb, const std::vector<uint32_t> &ib, const MeshCookingConfig *config = nullptr, size_t *cookedBytes = nullptr);
+    physx::PxConvexMesh* CookConvexMesh(const std::vector<float> &points, unsigned vertexLimit);
 
     extern PhysxSDKImpl* gPhysxSDKImpl;
 
@@ -2,13 +2,81 @@
 #include "physx_wrap_impl.h"
 #include "scene_info_mgr.h"
 #include "physx_sdk.h"
+#include "mesh_registry.h"
+#include "async_loader.h"
+#include "transform_codec.h"
 #include "log.h"
 #include <cassert>
 
+// appends a call to the room's command log, if recording
+#define RECORD(OP, ...) if (mImpl->mRecorder) { mImpl->mRecorder->Write(OP, __VA_ARGS__); }
+
 #define DEFAULT_DENSITY (1.0f)
+#define DEFAULT_SCRATCH_SIZE (1024 * 128)
 
 namespace PhysxWrap {
 
+    BodyDesc::BodyDesc()
+        : Material(eCurrentMaterial)
+        , Density(DEFAULT_DENSITY)
+        , Mass(0.0f)
+    {
+
+    }
+
+    ShapeDesc::ShapeDesc()
+        : Type(eShapeBox)
+        , Postion(Vector3{ 0.0f, 0.0f, 0.0f })
+        , Rotate(Quat{ 0.0f, 0.0f, 0.0f, 1.0f })
+        , HalfExtents(Vector3{ 0.5f, 0.5f, 0.5f })
+        , Radius(0.5f)
+        , HalfHeight(0.5f)
+        , Material(eCurrentMaterial)
+    {
+
+    }
+
+    SceneConfig::SceneConfig()
+        : Gravity(Vector3{ 0.0f, -9.81f, 0.0f })
+        , EnablePCM(true)
+        , EnableStabilization(true)
+        , SuppressEagerRefit(true)
+        , EnableCCD(false)
+        , FrictionType(eFrictionPatch)
+        , BounceThreshold(2.0f)
+        , SolverPositionIterations(4)
+        , SolverVelocityIterations(1)
+        , SleepThreshold(0.005f)
+        , BroadPhase(eBroadPhaseSAP)
+        , RegionSubdivisions(4)
+        , WorldMin(Vector3{ 0.0f, 0.0f, 0.0f })
+        , WorldMax(Vector3{ 0.0f, 0.0f, 0.0f })
+        , ThreadCount(0)
+        , ScratchSize(DEFAULT_SCRATCH_SIZE)
+        , MaxActors(0)
+        , MaxBodies(0)
+        , MaxStaticShapes(0)
+        , MaxDynamicShapes(0)
+        , ThreadSafe(false)
+        , QueryOnly(false)
+        , DynamicTreeRebuildRate(100)
+        , EnhancedDeterminism(false)
+    {
+
+    }
+
+    MeshCookingConfig::MeshCookingConfig()
+        : WeldTolerance(0.0f)
+        , Midphase(eMidphaseBVH33)
+        , CookingHint(eHintSimPerformance)
+        , SizePerformanceTradeOff(0.55f)
+        , TrisPerLeaf(4)
+        , SuppressRemapTable(false)
+        , DisableActiveEdges(false)
+    {
+
+    }
+
     PhysxScene::PhysxScene()
         : mImpl(new PhysxSceneImpl())
     {
@@ -26,90 +94,272 @@ namespace PhysxWrap {
     }
 
     bool PhysxScene::Init() {
-        return mImpl->Init();
+        return mImpl->Init(SceneConfig());
+    }
+
+    bool PhysxScene::Init(const SceneConfig &config) {
+        return mImpl->Init(config);
     }
 
     bool PhysxScene::CreateScene(const std::string &path) {
+        RECORD(eOpCreateScene, path);
         return mImpl->CreateScene(path);
     }
 
+    void PhysxScene::CreateSceneAsync(const std::string &path, const SceneConfig &config, const std::function<void(PhysxScene*)> &callback) {
+        // a scene evicted before the task runs is simply loaded on the room thread
+        bool cached = path == "" || gSceneInfoMgr->Get(path) != nullptr;
+        (cached ? gRoomLoader : gAsyncLoader)->Post([path, config, callback]() {
+            PhysxScene* scene = new PhysxScene();
+            if (!scene->Init(config) || !scene->CreateScene(path)) {
+                delete scene;
+                scene = nullptr;
+            }
+            callback(scene);
+        });
+    }
+
+    std::future<PhysxScene*> PhysxScene::CreateSceneAsync(const std::string &path, const SceneConfig &config) {
+        auto promise = std::make_shared<std::promise<PhysxScene*>>();
+        CreateSceneAsync(path, config, [promise](PhysxScene* scene) {
+            promise->set_value(scene);
+        });
+        return promise->get_future();
+    }
+
     void PhysxScene::release() {
         mImpl->release();
     }
 
     void  PhysxScene::Update(float elapsedTime) {
+        RECORD(eOpUpdate, elapsedTime);
         mImpl->Update(elapsedTime);
     }
 
+    void PhysxScene::FlushQueryUpdates() {
+        mImpl->FlushQueryUpdates();
+    }
+
+    void PhysxScene::SetFixedTimestep(float step, unsigned maxSubSteps) {
+        RECORD(eOpSetFixedTimestep, step, maxSubSteps);
+        mImpl->SetFixedTimestep(step, maxSubSteps);
+    }
+
+    float PhysxScene::GetInterpolationAlpha() {
+        return mImpl->GetInterpolationAlpha();
+    }
+
+    Vector3 PhysxScene::GetInterpolatedPostion(uint64_t id) {
+        physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        if (actor == 0) {
+            return Vector3{};
+        }
+        auto pose = mImpl->GetInterpolatedPose(actor);
+        return Vector3{ pose.p.x, pose.p.y, pose.p.z };
+    }
+
+    Quat PhysxScene::GetInterpolatedRotate(uint64_t id) {
+        physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        if (actor == 0) {
+            return Quat{};
+        }
+        auto pose = mImpl->GetInterpolatedPose(actor);
+        return Quat{ pose.q.x, pose.q.y, pose.q.z, pose.q.w };
+    }
+
     uint64_t PhysxScene::CreatePlane(float yAxis) {
-        return (uint64_t)mImpl->CreatePlane(0, 1, 0, yAxis);
+        auto id = (uint64_t)mImpl->CreatePlane(0, 1, 0, yAxis);
+        RECORD(eOpCreatePlane, yAxis, id);
+        return id;
     }
 
     uint64_t PhysxScene::CreateHeightField(const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale) {
-        return (uint64_t)mImpl->CreateHeightField(heightmap, columns, rows, scale);
+        auto id = (uint64_t)mImpl->CreateHeightField(heightmap, columns, rows, scale);
+        RECORD(eOpCreateHeightField, heightmap, columns, rows, scale, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateBoxDynamic(const Vector3 &pos, const Vector3 &halfExtents) {
-        return (uint64_t)mImpl->CreateBoxDynamic(pos, halfExtents, DEFAULT_DENSITY);
+    uint64_t PhysxScene::CreateHeightField(const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale, const std::vector<uint8_t> &cellMaterials, const std::vector<Material> &materials) {
+        auto id = (uint64_t)mImpl->CreateHeightField(heightmap, columns, rows, scale, cellMaterials, materials);
+        RECORD(eOpCreateHeightFieldMaterials, heightmap, columns, rows, scale, cellMaterials, materials, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateBoxKinematic(const Vector3 &pos, const Vector3 &halfExtents) {
-        return (uint64_t)mImpl->CreateBoxKinematic(pos, halfExtents, DEFAULT_DENSITY);
+    uint64_t PhysxScene::CreateBoxDynamic(const Vector3 &pos, const Vector3 &halfExtents, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateBoxDynamic(pos, halfExtents, body);
+        RECORD(eOpCreateBoxDynamic, pos, halfExtents, body, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateBoxStatic(const Vector3 &pos, const Vector3 &halfExtents) {
-        return (uint64_t)mImpl->CreateBoxStatic(pos, halfExtents);
+    uint64_t PhysxScene::CreateBoxKinematic(const Vector3 &pos, const Vector3 &halfExtents, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateBoxKinematic(pos, halfExtents, body);
+        RECORD(eOpCreateBoxKinematic, pos, halfExtents, body, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateSphereDynamic(const Vector3 &pos, float radius) {
-        return (uint64_t)mImpl->CreateSphereDynamic(pos, radius, DEFAULT_DENSITY);
+    uint64_t PhysxScene::CreateBoxStatic(const Vector3 &pos, const Vector3 &halfExtents, unsigned material) {
+        auto id = (uint64_t)mImpl->CreateBoxStatic(pos, halfExtents, material);
+        RECORD(eOpCreateBoxStatic, pos, halfExtents, material, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateSphereKinematic(const Vector3 &pos, float radius) {
-        return (uint64_t)mImpl->CreateSphereKinematic(pos, radius, DEFAULT_DENSITY);
+    uint64_t PhysxScene::CreateSphereDynamic(const Vector3 &pos, float radius, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateSphereDynamic(pos, radius, body);
+        RECORD(eOpCreateSphereDynamic, pos, radius, body, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateSphereStatic(const Vector3 &pos, float radius) {
-        return (uint64_t)mImpl->CreateSphereStatic(pos, radius);
+    uint64_t PhysxScene::CreateSphereKinematic(const Vector3 &pos, float radius, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateSphereKinematic(pos, radius, body);
+        RECORD(eOpCreateSphereKinematic, pos, radius, body, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateCapsuleDynamic(const Vector3 &pos, float radius, float halfHeight) {
-        return (uint64_t)mImpl->CreateCapsuleDynamic(pos, radius, halfHeight, DEFAULT_DENSITY);
+    uint64_t PhysxScene::CreateSphereStatic(const Vector3 &pos, float radius, unsigned material) {
+        auto id = (uint64_t)mImpl->CreateSphereStatic(pos, radius, material);
+        RECORD(eOpCreateSphereStatic, pos, radius, material, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateCapsuleKinematic(const Vector3 &pos, float radius, float halfHeight) {
-        return (uint64_t)mImpl->CreateCapsuleKinematic(pos, radius, halfHeight, DEFAULT_DENSITY);
+    uint64_t PhysxScene::CreateCapsuleDynamic(const Vector3 &pos, float radius, float halfHeight, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateCapsuleDynamic(pos, radius, halfHeight, body);
+        RECORD(eOpCreateCapsuleDynamic, pos, radius, halfHeight, body, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateCapsuleStatic(const Vector3 &pos, float radius, float halfHeight) {
-        return (uint64_t)mImpl->CreateCapsuleStatic(pos, radius, halfHeight);
+    uint64_t PhysxScene::CreateCapsuleKinematic(const Vector3 &pos, float radius, float halfHeight, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateCapsuleKinematic(pos, radius, halfHeight, body);
+        RECORD(eOpCreateCapsuleKinematic, pos, radius, halfHeight, body, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib) {
-        return (uint64_t)mImpl->CreateMeshKinematic(pos, scale, vb, ib, DEFAULT_DENSITY);
+    uint64_t PhysxScene::CreateCapsuleStatic(const Vector3 &pos, float radius, float halfHeight, unsigned material) {
+        auto id = (uint64_t)mImpl->CreateCapsuleStatic(pos, radius, halfHeight, material);
+        RECORD(eOpCreateCapsuleStatic, pos, radius, halfHeight, material, id);
+        return id;
     }
 
-    uint64_t PhysxScene::CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib) {
-        return (uint64_t)mImpl->CreateMeshStatic(pos, scale, vb, ib);
+    uint64_t PhysxScene::CreateConvexDynamic(const Vector3 &pos, const std::vector<float> &points, unsigned vertexLimit, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateConvexDynamic(pos, points, vertexLimit, body);
+        RECORD(eOpCreateConvexDynamic, pos, points, vertexLimit, body, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateConvexKinematic(const Vector3 &pos, const std::vector<float> &points, unsigned vertexLimit, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateConvexKinematic(pos, points, vertexLimit, body);
+        RECORD(eOpCreateConvexKinematic, pos, points, vertexLimit, body, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateMeshKinematic(pos, scale, vb, ib, body);
+        RECORD(eOpCreateMeshKinematic, pos, scale, vb, ib, body, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, unsigned material) {
+        auto id = (uint64_t)mImpl->CreateMeshStatic(pos, scale, vb, ib, material);
+        RECORD(eOpCreateMeshStatic, pos, scale, vb, ib, material, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateMeshKinematic(pos, scale, vb, ib, body);
+        RECORD(eOpCreateMeshKinematic32, pos, scale, vb, ib, body, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib, unsigned material) {
+        auto id = (uint64_t)mImpl->CreateMeshStatic(pos, scale, vb, ib, material);
+        RECORD(eOpCreateMeshStatic32, pos, scale, vb, ib, material, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateMeshKinematic(uint64_t meshId, const Vector3 &pos, const Quat &rotate, const Vector3 &scale, const BodyDesc &body) {
+        if (mImpl->mRecorder) {
+            mImpl->mRecorder->Invalidate("CreateMeshKinematic(meshId)");
+        }
+        return (uint64_t)mImpl->CreateMeshKinematic(meshId, pos, rotate, scale, body);
+    }
+
+    uint64_t PhysxScene::CreateMeshStatic(uint64_t meshId, const Vector3 &pos, const Quat &rotate, const Vector3 &scale, unsigned material) {
+        if (mImpl->mRecorder) {
+            mImpl->mRecorder->Invalidate("CreateMeshStatic(meshId)");
+        }
+        return (uint64_t)mImpl->CreateMeshStatic(meshId, pos, rotate, scale, material);
+    }
+
+    uint64_t PhysxScene::CreateCompoundDynamic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateCompoundDynamic(pos, rotate, shapes, body);
+        RECORD(eOpCreateCompoundDynamic, pos, rotate, shapes, body, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateCompoundKinematic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body) {
+        auto id = (uint64_t)mImpl->CreateCompoundKinematic(pos, rotate, shapes, body);
+        RECORD(eOpCreateCompoundKinematic, pos, rotate, shapes, body, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateCompoundStatic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes) {
+        auto id = (uint64_t)mImpl->CreateCompoundStatic(pos, rotate, shapes);
+        RECORD(eOpCreateCompoundStatic, pos, rotate, shapes, id);
+        return id;
+    }
+
+    uint64_t PhysxScene::CreateAggregate(unsigned maxActors, bool selfCollision) {
+        auto id = (uint64_t)mImpl->CreateAggregate(maxActors, selfCollision);
+        RECORD(eOpCreateAggregate, maxActors, selfCollision, id);
+        return id;
+    }
+
+    bool PhysxScene::AddToAggregate(uint64_t aggregateId, uint64_t id) {
+        physx::PxAggregate* aggregate = (physx::PxAggregate*)aggregateId;
+        physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpAddToAggregate, aggregateId, id);
+        return mImpl->AddToAggregate(aggregate, actor);
+    }
+
+    void PhysxScene::RemoveAggregate(uint64_t aggregateId) {
+        physx::PxAggregate* aggregate = (physx::PxAggregate*)aggregateId;
+        RECORD(eOpRemoveAggregate, aggregateId);
+        mImpl->RemoveAggregate(aggregate);
+    }
+
+    uint64_t PhysxScene::CreateCapsuleController(const Vector3 &pos, float radius, float halfHeight, float stepOffset, float slopeLimit) {
+        auto id = (uint64_t)mImpl->CreateCapsuleController(pos, radius, halfHeight, stepOffset, slopeLimit);
+        RECORD(eOpCreateCapsuleController, pos, radius, halfHeight, stepOffset, slopeLimit, id);
+        return id;
+    }
+
+    void PhysxScene::MoveControllers(const uint64_t *ids, const Vector3 *displacements, unsigned count, float elapsedTime, uint8_t *outFlags) {
+        if (mImpl->mRecorder) {
+            mImpl->mRecorder->Write(eOpMoveControllers, std::vector<uint64_t>(ids, ids + count), std::vector<Vector3>(displacements, displacements + count), elapsedTime);
+        }
+        mImpl->MoveControllers(ids, displacements, count, elapsedTime, outFlags);
     }
 
     void PhysxScene::RemoveActor(uint64_t id) {
         physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpRemoveActor, id);
         mImpl->RemoveActor(actor);
     }
 
     void PhysxScene::SetLinearVelocity(uint64_t id, const Vector3 &velocity) {
         physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpSetLinearVelocity, id, velocity);
         mImpl->SetLinearVelocity(actor, velocity);
     }
 
     void PhysxScene::AddForce(uint64_t id, const Vector3 &force) {
         physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpAddForce, id, force);
         mImpl->AddForce(actor, force);
     }
 
     void PhysxScene::ClearForce(uint64_t id) {
         physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpClearForce, id);
         mImpl->ClearForce(actor);
     }
 
@@ -125,11 +375,13 @@ namespace PhysxWrap {
 
     void PhysxScene::SetGlobalPostion(uint64_t id, const Vector3 &pos) {
         physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpSetGlobalPostion, id, pos);
         mImpl->SetGlobalPostion(actor, pos);
     }
 
     void PhysxScene::SetGlobalRotate(uint64_t id, const Quat &rotate) {
         physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpSetGlobalRotate, id, rotate);
         mImpl->SetGlobalRotate(actor, rotate);
     }
 
@@ -143,23 +395,251 @@ namespace PhysxWrap {
         return mImpl->IsDynamicObj(actor);
     }
 
+    bool PhysxScene::SetTrigger(uint64_t id, bool trigger) {
+        physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpSetTrigger, id, trigger);
+        return mImpl->SetTrigger(actor, trigger);
+    }
+
+    void PhysxScene::EnableContactEvents(uint64_t id, bool enable) {
+        physx::PxRigidActor* actor = (physx::PxRigidActor*)id;
+        RECORD(eOpEnableContactEvents, id, enable);
+        mImpl->EnableContactEvents(actor, enable);
+    }
+
+    void PhysxScene::SetEventCapacity(unsigned capacity) {
+        mImpl->SetEventCapacity(capacity);
+    }
+
+    unsigned PhysxScene::DrainEvents(PhysicsEvent *buffer, unsigned capacity) {
+        return mImpl->DrainEvents(buffer, capacity);
+    }
+
+    unsigned PhysxScene::GetDroppedEvents() {
+        return mImpl->GetDroppedEvents();
+    }
+
+    unsigned PhysxScene::CreateMaterial(float staticFriction, float dynamicFriction, float restitution) {
+        RECORD(eOpCreateMaterial, staticFriction, dynamicFriction, restitution);
+        return mImpl->CreateMaterial(staticFriction, dynamicFriction, restitution);
+    }
+
+    void PhysxScene::SetCurrentMaterial(unsigned index) {
+        RECORD(eOpSetCurrentMaterialIndex, index);
+        mImpl->SetCurrentMaterial(index);
+    }
+
     void PhysxScene::SetCurrentMaterial(float staticFriction, float dynamicFriction, float restitution) {
+        RECORD(eOpSetCurrentMaterial, staticFriction, dynamicFriction, restitution);
         mImpl->SetCurrentMaterial(staticFriction, dynamicFriction, restitution);
     }
 
     void PhysxScene::SetCurrentAngularDamping(float value) {
+        RECORD(eOpSetCurrentAngularDamping, value);
         mImpl->SetCurrentAngularDamping(value);
     }
 
+    bool PhysxScene::Raycast(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) {
+        return mImpl->Raycast(origin, unitDir, distance, hit);
+    }
+
+    bool PhysxScene::RaycastDynamic(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) {
+        return mImpl->RaycastDynamic(origin, unitDir, distance, hit);
+    }
+
+    void PhysxScene::EnableHistory(unsigned frames) {
+        RECORD(eOpEnableHistory, frames);
+        mImpl->EnableHistory(frames);
+    }
+
+    float PhysxScene::GetSimulationTime() {
+        return mImpl->GetSimulationTime();
+    }
+
+    bool PhysxScene::RaycastAt(float time, const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) {
+        return mImpl->RaycastAt(time, origin, unitDir, distance, hit);
+    }
+
+    void PhysxScene::CaptureTransforms(std::vector<uint8_t> &state, unsigned positionBits) {
+        mImpl->CaptureTransforms(state, positionBits);
+    }
+
+    void PhysxScene::EnableInterest(float cellSize) {
+        RECORD(eOpEnableInterest, cellSize);
+        mImpl->EnableInterest(cellSize);
+    }
+
+    void PhysxScene::QueryInterest(const Vector3 *observers, unsigned count, float radius, std::vector<uint64_t> &ids, std::vector<unsigned> &offsets) {
+        mImpl->QueryInterest(observers, count, radius, ids, offsets);
+    }
+
+    void PhysxScene::SampleTerrainHeights(const float *xz, unsigned count, float *heights, uint8_t *outHit) {
+        mImpl->SampleTerrainHeights(xz, count, heights, outHit);
+    }
+
+    void PhysxScene::Snapshot(std::vector<uint8_t> &buffer) {
+        mImpl->Snapshot(buffer);
+    }
+
+    bool PhysxScene::Restore(const std::vector<uint8_t> &buffer) {
+        if (mImpl->mRecorder) {
+            mImpl->mRecorder->Invalidate("Restore");
+        }
+        return mImpl->Restore(buffer);
+    }
+
+    PhysxScene* PhysxScene::Clone(const std::vector<uint8_t> &snapshot, std::unordered_map<uint64_t, uint64_t> &idMap) {
+        auto scene = new PhysxScene();
+        if (!mImpl->Clone(*scene->mImpl, snapshot, idMap)) {
+            ERROR("[physx] clone scene failed!");
+            delete scene;
+            return nullptr;
+        }
+        return scene;
+    }
+
+    bool PhysxScene::StartRecording(const std::string &path) {
+        // the log starts from the config alone, so nothing set since Init may be left out of it
+        if (mImpl->mScene == nullptr || !mImpl->IsInitState()) {
+            ERROR("[physx] start recording fail. call it after Init and before CreateScene, any create or setter. path = %s", path.c_str());
+            return false;
+        }
+        std::unique_ptr<CommandRecorder> recorder(new CommandRecorder());
+        if (!recorder->Open(path, mImpl->mConfig)) {
+            return false;
+        }
+        mImpl->mRecorder = std::move(recorder);
+        return true;
+    }
+
+    void PhysxScene::StopRecording() {
+        mImpl->mRecorder.reset();
+    }
+
     MY_DLL_EXPORT_FUNC unsigned GetStaticObjCountInScene(const std::string &path) {
         return gSceneInfoMgr->GetStaticObjCount(path);
     }
 
+    MY_DLL_EXPORT_FUNC void PreloadSceneInfo(const std::string &path) {
+        gAsyncLoader->Post([path]() {
+            gSceneInfoMgr->GetOrLoad(path);
+        });
+    }
+
+    MY_DLL_EXPORT_FUNC void UnloadSceneInfo(const std::string &path) {
+        gSceneInfoMgr->Remove(path);
+    }
+
+    MY_DLL_EXPORT_FUNC void SetSceneCacheBudget(uint64_t bytes) {
+        gSceneInfoMgr->SetBudget(bytes);
+    }
+
+    MY_DLL_EXPORT_FUNC uint64_t GetSceneInfoBytes(const std::string &path) {
+        return gSceneInfoMgr->GetBytes(path);
+    }
+
+    MY_DLL_EXPORT_FUNC uint64_t GetSceneCacheBytes() {
+        return gSceneInfoMgr->GetTotalBytes();
+    }
+
+    MY_DLL_EXPORT_FUNC bool RaycastStaticWorld(const std::string &path, const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) {
+        auto sceneInfo = gSceneInfoMgr->Get(path);
+        return sceneInfo && sceneInfo->GetStaticWorld().Raycast(origin, unitDir, distance, hit);
+    }
+
+    MY_DLL_EXPORT_FUNC bool RaycastStaticWorldBatch(const std::string &path, const Vector3 *origins, const Vector3 *unitDirs, const float *distances, unsigned count, RaycastHit *hits, uint8_t *outHit) {
+        auto sceneInfo = gSceneInfoMgr->Get(path);
+        if (!sceneInfo) {
+            return false;
+        }
+        sceneInfo->GetStaticWorld().RaycastBatch(origins, unitDirs, distances, count, hits, outHit);
+        return true;
+    }
+
+    MY_DLL_EXPORT_FUNC unsigned OverlapStaticWorldSphere(const std::string &path, const Vector3 &center, float radius, uint32_t *indices, unsigned capacity) {
+        auto sceneInfo = gSceneInfoMgr->Get(path);
+        return sceneInfo ? sceneInfo->GetStaticWorld().OverlapSphere(center, radius, indices, capacity) : 0;
+    }
+
+    MY_DLL_EXPORT_FUNC bool SampleStaticWorldHeights(const std::string &path, const float *xz, unsigned count, float *heights, uint8_t *outHit) {
+        auto sceneInfo = gSceneInfoMgr->Get(path);
+        if (!sceneInfo) {
+            return false;
+        }
+        sceneInfo->GetStaticWorld().SampleHeights(xz, count, heights, outHit);
+        return true;
+    }
+
+    MY_DLL_EXPORT_FUNC bool EncodeTransformDelta(const std::vector<uint8_t> &baseline, const std::vector<uint8_t> &state, std::vector<uint8_t> &packet) {
+        return TransformCodec::EncodeDelta(baseline, state, packet);
+    }
+
+    MY_DLL_EXPORT_FUNC bool DecodeTransformDelta(const std::vector<uint8_t> &baseline, const std::vector<uint8_t> &packet, std::vector<uint8_t> &state) {
+        return TransformCodec::DecodeDelta(baseline, packet, state);
+    }
+
+    MY_DLL_EXPORT_FUNC bool ReplayRecording(const std::string &path, unsigned threadCount, std::vector<float> &updateMs, uint64_t &stateHash) {
+        return ReplayCommandLog(path, threadCount, updateMs, stateHash);
+    }
+
+    MY_DLL_EXPORT_FUNC bool ReadTransforms(const std::vector<uint8_t> &state, std::vector<uint64_t> &ids, std::vector<Vector3> &postions, std::vector<Quat> &rotates) {
+        std::vector<TransformCodec::Pose> poses;
+        if (!TransformCodec::Dequantize(state, poses)) {
+            return false;
+        }
+        ids.resize(poses.size());
+        postions.resize(poses.size());
+        rotates.resize(poses.size());
+        for (size_t i = 0; i < poses.size(); i++) {
+            auto &pose = poses[i].Transform;
+            ids[i] = poses[i].Id;
+            postions[i] = Vector3{ pose.p.x, pose.p.y, pose.p.z };
+            rotates[i] = Quat{ pose.q.x, pose.q.y, pose.q.z, pose.q.w };
+        }
+        return true;
+    }
+
+    MY_DLL_EXPORT_FUNC void SetTerrainTileSize(unsigned cells) {
+        gSceneInfoMgr->SetTerrainTileSize(cells);
+    }
+
+    MY_DLL_EXPORT_FUNC uint64_t RegisterMesh(const std::vector<float> &vb, const std::vector<uint16_t> &ib) {
+        return gMeshRegistry->Register(vb, ib);
+    }
+
+    MY_DLL_EXPORT_FUNC uint64_t RegisterMesh32(const std::vector<float> &vb, const std::vector<uint32_t> &ib) {
+        return gMeshRegistry->Register(vb, ib);
+    }
+
+    MY_DLL_EXPORT_FUNC uint64_t RegisterMeshWithConfig(const std::vector<float> &vb, const std::vector<uint16_t> &ib, const MeshCookingConfig &config) {
+        return gMeshRegistry->Register(vb, ib, &config);
+    }
+
+    MY_DLL_EXPORT_FUNC uint64_t RegisterMesh32WithConfig(const std::vector<float> &vb, const std::vector<uint32_t> &ib, const MeshCookingConfig &config) {
+        return gMeshRegistry->Register(vb, ib, &config);
+    }
+
+    MY_DLL_EXPORT_FUNC void UnregisterMesh(uint64_t meshId) {
+        gMeshRegistry->Unregister(meshId);
+    }
+
+    MY_DLL_EXPORT_FUNC uint64_t GetRegisteredMeshBytes() {
+        return gMeshRegistry->GetCookedBytes();
+    }
+
+    MY_DLL_EXPORT_FUNC void SetMeshCookingConfig(const MeshCookingConfig &config) {
+        gPhysxSDKImpl->SetMeshCookingConfig(config);
+    }
+
     MY_DLL_EXPORT_FUNC bool InitPhysxSDK() {
         return gPhysxSDKImpl->Init();
     }
 
     MY_DLL_EXPORT_FUNC void ReleasePhysxSDK() {
+        gAsyncLoader->Stop();
+        gRoomLoader->Stop();
+        gSceneInfoMgr->Clear();
+        gMeshRegistry->Clear();
         gPhysxSDKImpl->Release();
     }
 }
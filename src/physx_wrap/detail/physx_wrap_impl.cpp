@@ -3,12 +3,17 @@
 #include <PxRigidStatic.h>
 #include <PxRigidDynamic.h>
 #include <extensions/PxExtensionsAPI.h>
+#include <characterkinematic/PxCapsuleController.h>
 #include <PxMaterial.h>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
 #include "log.h"
 #include "util.h"
 #include "scene_info_mgr.h"
 #include "physx_sdk.h"
+#include "mesh_registry.h"
 
 #ifdef _MSC_VER
 #ifdef _DEBUG
@@ -18,6 +23,7 @@
 #pragma comment(lib, "PhysX3CommonDEBUG_x64.lib")
 #pragma comment(lib, "PhysX3CookingDEBUG_x64.lib")
 #pragma comment(lib, "PxPvdSDKDEBUG_x64.lib")
+#pragma comment(lib, "PhysX3CharacterKinematicDEBUG_x64.lib")
 #else
 #pragma comment(lib, "PhysX3_x64.lib")
 #pragma comment(lib, "PxFoundation_x64.lib")
@@ -25,25 +31,43 @@
 #pragma comment(lib, "PhysX3Common_x64.lib")
 #pragma comment(lib, "PhysX3Cooking_x64.lib")
 #pragma comment(lib, "PxPvdSDK_x64.lib")
+#pragma comment(lib, "PhysX3CharacterKinematic_x64.lib")
 #endif
 #endif
 
+// scenes lock only when SceneConfig::ThreadSafe is set, or always in these builds
 #if defined(SCENE_SAFE_THREAD) || defined(_DEBUG)
-#define SCENE_LOCK() physx::PxSceneWriteLock scopedLock(*mScene);
+#define FORCE_SCENE_LOCK (true)
 #else
-#define SCENE_LOCK()
+#define FORCE_SCENE_LOCK (false)
 #endif
+#define SCENE_LOCK() SceneWriteLock scopedLock(mLocking ? mScene : nullptr);
+#define SCENE_READ_LOCK() SceneReadLock scopedLock(mLocking ? mScene : nullptr);
 
 #define	SAFE_RELEASE(x)	if(x){ x->release(); x = NULL;	}
 #define DEFAULT_RIGID_DYNAMIC(ACTOR)                                                \
     ACTOR->setAngularDamping(mAngularDamping);                                      \
     ACTOR->setRigidBodyFlag(physx::PxRigidBodyFlag::eKINEMATIC, false);             \
+    ACTOR->setRigidBodyFlag(physx::PxRigidBodyFlag::eENABLE_CCD, mConfig.EnableCCD); \
+    ACTOR->setSolverIterationCounts(mConfig.SolverPositionIterations, mConfig.SolverVelocityIterations); \
+    ACTOR->setSleepThreshold(mConfig.SleepThreshold);                               \
 
 #define DEFAULT_RIGID_DYNAMIC_DEBUG(ACTOR)                                          \
     DEFAULT_RIGID_DYNAMIC(ACTOR)                                                    \
     ACTOR->setActorFlag(physx::PxActorFlag::eVISUALIZATION, true);                  \
 
-#define SCRATCH_BLOCK_SIZE (1024 * 128)
+#define SCRATCH_BLOCK_ALIGN (1024 * 16)
+#define MAX_SOLVER_ITERATIONS (255)
+#define DEFAULT_MAX_SUB_STEPS (4)
+#define DEFAULT_ANGULAR_DAMPING (0.5f)
+#define SNAPSHOT_MAGIC (0x504E5353) // "SSNP"
+#define CONTROLLER_MIN_MOVE (0.001f)
+#define MAX_AGGREGATE_ACTORS (128)
+#define MAX_REGION_SUBDIVISIONS (16)    // MBP supports up to 256 regions
+#define REGION_VERTICAL_MARGIN (500.0f)
+#define MIN_TREE_REBUILD_RATE (4)       // PhysX rejects lower hints
+#define GROUND_RAY_HEIGHT (10000.0f)    // SampleTerrainHeights raycasts start this high
+#define GROUND_BATCH_SIZE (64)
 
 namespace PhysxWrap {
     extern physx::PxDefaultAllocator gDefaultAllocatorCallback;
@@ -51,12 +75,47 @@ namespace PhysxWrap {
 
 namespace PhysxWrap {
 
+    // PxSceneReadLock/PxSceneWriteLock that do nothing for a null scene.
+    // A thread holding the write lock may take either lock again; a reader must not take the write lock.
+    class SceneReadLock
+    {
+    public:
+        explicit SceneReadLock(physx::PxScene* scene) : mScene(scene) { if (mScene) mScene->lockRead(); }
+        ~SceneReadLock() { if (mScene) mScene->unlockRead(); }
+    private:
+        physx::PxScene* mScene;
+    };
+
+    class SceneWriteLock
+    {
+    public:
+        explicit SceneWriteLock(physx::PxScene* scene) : mScene(scene) { if (mScene) mScene->lockWrite(); }
+        ~SceneWriteLock() { if (mScene) mScene->unlockWrite(); }
+    private:
+        physx::PxScene* mScene;
+    };
+
+    static unsigned clampIterations(unsigned count) {
+        return count < 1 ? 1 : (count > MAX_SOLVER_ITERATIONS ? MAX_SOLVER_ITERATIONS : count);
+    }
+
     PhysxSceneImpl::PhysxSceneImpl()
         : mScene(nullptr)
+        , mLocking(FORCE_SCENE_LOCK)
         , mCpuDispatcher(nullptr)
         , mMaterial(nullptr)
         , mScratchBlock(nullptr)
-        , mAngularDamping(0.5f)
+        , mAngularDamping(DEFAULT_ANGULAR_DAMPING)
+        , mControllerManager(nullptr)
+        , mFixedStep(0.0f)
+        , mMaxSubSteps(DEFAULT_MAX_SUB_STEPS)
+        , mAccumulator(0.0f)
+        , mStepCount(0)
+        , mSimTime(0.0f)
+        , mQueryUpdates(0)
+        , mCaptureBounds(physx::PxBounds3::empty())
+        , mTerrainDirty(false)
+        , mGroundQuery(nullptr)
     {
 
     }
@@ -68,30 +127,92 @@ namespace PhysxWrap {
 #endif
     }
 
-    bool PhysxSceneImpl::Init() {
-        mScratchBlock = gDefaultAllocatorCallback.allocate(SCRATCH_BLOCK_SIZE, 0, 0, 0);
+    bool PhysxSceneImpl::Init(const SceneConfig &config) {
+        mConfig = config;
+        mLocking = FORCE_SCENE_LOCK || config.ThreadSafe;
+        mConfig.ScratchSize = config.ScratchSize / SCRATCH_BLOCK_ALIGN * SCRATCH_BLOCK_ALIGN;
+        mConfig.SolverPositionIterations = clampIterations(config.SolverPositionIterations);
+        mConfig.SolverVelocityIterations = clampIterations(config.SolverVelocityIterations);
+        mConfig.DynamicTreeRebuildRate = std::max(config.DynamicTreeRebuildRate, unsigned(MIN_TREE_REBUILD_RATE));
+        if (config.QueryOnly) {
+            mConfig.SuppressEagerRefit = true;
+            mConfig.ScratchSize = 0;
+            mConfig.ThreadCount = 0;
+        }
+        else if (config.ThreadSafe && config.ThreadCount == 0) {
+            // without workers simulate() runs the whole step inline under the write lock, and queries never overlap it
+            WARNING("[physx] ThreadSafe scene with ThreadCount 0, using 1 worker");
+            mConfig.ThreadCount = 1;
+        }
+        if (mConfig.ScratchSize > 0) {
+            mScratchBlock = gDefaultAllocatorCallback.allocate(mConfig.ScratchSize, 0, 0, 0);
+        }
         mMaterial = gPhysxSDKImpl->GetPhysics()->createMaterial(0.5f, 0.5f, 1.0f);
         if (!mMaterial) {
             ERROR("[physx] createMaterial failed!");
             release();
             return false;
         }
+        mMaterials.push_back(mMaterial);
+        mMaterialIndex[std::make_tuple(0.5f, 0.5f, 1.0f)] = 0;
 
         physx::PxSceneDesc sceneDesc(gPhysxSDKImpl->GetPhysics()->getTolerancesScale());
-        sceneDesc.gravity = physx::PxVec3(0.0f, -9.81f, 0.0f);
-        mCpuDispatcher = physx::PxDefaultCpuDispatcherCreate(0);
+        sceneDesc.gravity = physx::PxVec3(config.Gravity.X, config.Gravity.Y, config.Gravity.Z);
+        mCpuDispatcher = physx::PxDefaultCpuDispatcherCreate(mConfig.ThreadCount);
         if (!mCpuDispatcher) {
             ERROR("PxDefaultCpuDispatcherCreate failed!");
             release();
             return false;
         }
         sceneDesc.cpuDispatcher = mCpuDispatcher;
-        sceneDesc.filterShader = physx::PxDefaultSimulationFilterShader;
-        sceneDesc.flags |= physx::PxSceneFlag::eENABLE_PCM;
-        sceneDesc.flags |= physx::PxSceneFlag::eENABLE_STABILIZATION;
+        sceneDesc.broadPhaseType = config.BroadPhase == eBroadPhaseMBP ? physx::PxBroadPhaseType::eMBP : physx::PxBroadPhaseType::eSAP;
+        FilterShaderData shaderData;
+        shaderData.Flags = config.EnableCCD ? FilterShaderData::eCCD : 0;
+        sceneDesc.filterShader = SimulationFilterShader;
+        sceneDesc.filterShaderData = &shaderData;     // copied by createScene
+        sceneDesc.filterShaderDataSize = sizeof(shaderData);
+        sceneDesc.simulationEventCallback = &mEvents;
         sceneDesc.flags |= physx::PxSceneFlag::eENABLE_ACTIVETRANSFORMS;
-        sceneDesc.flags |= physx::PxSceneFlag::eSUPPRESS_EAGER_SCENE_QUERY_REFIT;
-        customizeSceneDesc(sceneDesc);
+        if (config.ThreadSafe) {
+            // PhysX reports every unlocked access
+            sceneDesc.flags |= physx::PxSceneFlag::eREQUIRE_RW_LOCK;
+        }
+        if (config.EnhancedDeterminism) {
+            sceneDesc.flags |= physx::PxSceneFlag::eENABLE_ENHANCED_DETERMINISM;
+        }
+        if (config.EnablePCM) {
+            sceneDesc.flags |= physx::PxSceneFlag::eENABLE_PCM;
+        }
+        if (config.EnableStabilization) {
+            sceneDesc.flags |= physx::PxSceneFlag::eENABLE_STABILIZATION;
+        }
+        if (mConfig.SuppressEagerRefit) {
+            sceneDesc.flags |= physx::PxSceneFlag::eSUPPRESS_EAGER_SCENE_QUERY_REFIT;
+        }
+        if (config.EnableCCD) {
+            sceneDesc.flags |= physx::PxSceneFlag::eENABLE_CCD;
+        }
+        switch (config.FrictionType) {
+        case eFrictionOneDirectional:
+            sceneDesc.frictionType = physx::PxFrictionType::eONE_DIRECTIONAL;
+            break;
+        case eFrictionTwoDirectional:
+            sceneDesc.frictionType = physx::PxFrictionType::eTWO_DIRECTIONAL;
+            break;
+        default:
+            sceneDesc.frictionType = physx::PxFrictionType::ePATCH;
+            break;
+        }
+        sceneDesc.bounceThresholdVelocity = config.BounceThreshold;
+        sceneDesc.limits.maxNbActors = config.MaxActors;
+        sceneDesc.limits.maxNbBodies = config.MaxBodies;
+        sceneDesc.limits.maxNbStaticShapes = config.MaxStaticShapes;
+        sceneDesc.limits.maxNbDynamicShapes = config.MaxDynamicShapes;
+        if (!sceneDesc.isValid()) {
+            ERROR("[physx] invalid scene config");
+            release();
+            return false;
+        }
         mScene = gPhysxSDKImpl->GetPhysics()->createScene(sceneDesc);
         if (!mScene) {
             ERROR("[physx] createScene failed!");
@@ -109,19 +230,55 @@ namespace PhysxWrap {
             pvdClient->setScenePvdFlag(physx::PxPvdSceneFlag::eTRANSMIT_SCENEQUERIES, true);
         }
 #endif
+        {
+            SCENE_LOCK();
+            mScene->setDynamicTreeRebuildRateHint(mConfig.DynamicTreeRebuildRate);
+        }
+        mGroundResults.resize(GROUND_BATCH_SIZE);
+        physx::PxBatchQueryDesc groundDesc(GROUND_BATCH_SIZE, 0, 0);
+        groundDesc.queryMemory.userRaycastResultBuffer = mGroundResults.data();
+        {
+            SCENE_LOCK();
+            mGroundQuery = mScene->createBatchQuery(groundDesc);
+        }
+        if (!mGroundQuery) {
+            ERROR("[physx] createBatchQuery failed!");
+            release();
+            return false;
+        }
+        if (config.BroadPhase == eBroadPhaseMBP && config.WorldMin.X < config.WorldMax.X && config.WorldMin.Z < config.WorldMax.Z) {
+            addBroadPhaseRegions(physx::PxBounds3(physx::PxVec3(config.WorldMin.X, config.WorldMin.Y, config.WorldMin.Z), physx::PxVec3(config.WorldMax.X, config.WorldMax.Y, config.WorldMax.Z)));
+        }
         return true;
     }
 
     void PhysxSceneImpl::release() {
-        SAFE_RELEASE(mMaterial);
+        for (size_t i = 0; i < mMaterials.size(); i++) {
+            mMaterials[i]->release();
+        }
+        mMaterials.clear();
+        mMaterialIndex.clear();
+        mMaterial = nullptr;
         {
             SCENE_LOCK();
             for (auto it = mPhysicsActors.begin(); it != mPhysicsActors.end(); ++it) {
-                if (it->first != 0) {
+                if (it->first != 0 && it->second != eControllerActor) {
                     it->first->release();
                 }
             }
             mPhysicsActors.clear();
+            mInterpolation.clear();
+            for (auto it = mAggregates.begin(); it != mAggregates.end(); ++it) {
+                (*it)->release();
+            }
+            mAggregates.clear();
+            // releases the controllers and their actors
+            SAFE_RELEASE(mControllerManager);
+            mControllers.clear();
+            mHeightFields.clear();
+            mHeightFieldPoses.clear();
+            mTerrainSampler.Clear();
+            SAFE_RELEASE(mGroundQuery);
         }
         SAFE_RELEASE(mScene);
         SAFE_RELEASE(mCpuDispatcher);
@@ -133,13 +290,191 @@ namespace PhysxWrap {
     }
 
     void PhysxSceneImpl::Update(float dtime) {
-        if (mScene != nullptr) {
+        if (mScene == nullptr || dtime <= 0.0f) {
+            return;
+        }
+        if (mConfig.QueryOnly) {
+            updateQueries(dtime);
+            return;
+        }
+        float fixedStep;
+        float accumulator;
+        unsigned steps;
+        {
+            // readers take mAccumulator/mFixedStep under the read lock for GetInterpolationAlpha
             SCENE_LOCK();
-            if (dtime > 0.0f) {
-                mScene->simulate(dtime, 0, mScratchBlock, mScratchBlock ? SCRATCH_BLOCK_SIZE : 0, false);
-                mScene->fetchResults();
+            fixedStep = mFixedStep;
+            accumulator = mAccumulator + dtime;
+            steps = fixedStep > 0.0f ? std::min(unsigned(accumulator / fixedStep), mMaxSubSteps) : 0;
+        }
+        if (fixedStep <= 0.0f) {
+            simulate(dtime);
+            return;
+        }
+
+        for (unsigned i = 0; i < steps; i++) {
+            simulate(fixedStep);
+            recordInterpolation();
+        }
+        accumulator -= steps * fixedStep;
+        if (accumulator >= fixedStep) {
+            // over budget: drop the backlog instead of spiralling
+            accumulator = std::fmod(accumulator, fixedStep);
+        }
+        SCENE_LOCK();
+        mAccumulator = accumulator;
+    }
+
+    void PhysxSceneImpl::simulate(float dtime) {
+        {
+            SCENE_LOCK();
+            mScene->simulate(dtime, 0, mScratchBlock, mScratchBlock ? mConfig.ScratchSize : 0, false);
+        }
+        // no lock while the step runs: readers on other threads see the previous frame
+        mScene->checkResults(true);
+        SCENE_LOCK();
+        mScene->fetchResults(true);
+        if (mInterest.Enabled()) {
+            updateInterest();
+        }
+        mSimTime += dtime;
+        if (mHistory.Enabled()) {
+            mHistory.Record(mSimTime, mPhysicsActors);
+        }
+    }
+
+    // QueryOnly stand-in for simulate: kinematic moves only refit the query trees, and without simulate
+    // PhysX never steps the incremental rebuild, so the dynamic tree is rebuilt at the configured rate
+    void PhysxSceneImpl::updateQueries(float dtime) {
+        SCENE_LOCK();
+        mScene->flushQueryUpdates();
+        if (++mQueryUpdates >= mConfig.DynamicTreeRebuildRate) {
+            mQueryUpdates = 0;
+            mScene->forceDynamicTreeRebuild(false, true);
+        }
+        mSimTime += dtime;
+        if (mHistory.Enabled()) {
+            mHistory.Record(mSimTime, mPhysicsActors);
+        }
+    }
+
+    void PhysxSceneImpl::FlushQueryUpdates() {
+        if (mScene == nullptr) {
+            return;
+        }
+        SCENE_LOCK();
+        mScene->flushQueryUpdates();
+    }
+
+    void PhysxSceneImpl::recordInterpolation() {
+        SCENE_LOCK();
+        mStepCount++;
+        physx::PxU32 count = 0;
+        const physx::PxActiveTransform* transforms = mScene->getActiveTransforms(count);
+        for (physx::PxU32 i = 0; i < count; i++) {
+            auto actor = static_cast<physx::PxRigidActor*>(transforms[i].actor);
+            auto it = mInterpolation.find(actor);
+            if (it == mInterpolation.end()) {
+                mInterpolation[actor] = InterpolationState{ transforms[i].actor2World, transforms[i].actor2World, mStepCount };
+                continue;
             }
+            auto &state = it->second;
+            state.Prev = state.Curr;
+            state.Curr = transforms[i].actor2World;
+            state.Step = mStepCount;
+        }
+    }
+
+    bool PhysxSceneImpl::Raycast(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) {
+        if (mScene == nullptr) {
+            return false;
+        }
+        SCENE_READ_LOCK();
+        physx::PxRaycastBuffer buffer;
+        if (!mScene->raycast(physx::PxVec3(origin.X, origin.Y, origin.Z), physx::PxVec3(unitDir.X, unitDir.Y, unitDir.Z), distance, buffer) || !buffer.hasBlock) {
+            return false;
+        }
+        hit.Id = (uint64_t)buffer.block.actor;
+        hit.Postion = Vector3{ buffer.block.position.x, buffer.block.position.y, buffer.block.position.z };
+        hit.Normal = Vector3{ buffer.block.normal.x, buffer.block.normal.y, buffer.block.normal.z };
+        hit.Distance = buffer.block.distance;
+        return true;
+    }
+
+    bool PhysxSceneImpl::RaycastDynamic(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) {
+        if (mScene == nullptr) {
+            return false;
+        }
+        SCENE_READ_LOCK();
+        physx::PxRaycastBuffer buffer;
+        physx::PxQueryFilterData filterData(physx::PxQueryFlag::eDYNAMIC);
+        if (!mScene->raycast(physx::PxVec3(origin.X, origin.Y, origin.Z), physx::PxVec3(unitDir.X, unitDir.Y, unitDir.Z), distance, buffer, physx::PxHitFlag::eDEFAULT, filterData) || !buffer.hasBlock) {
+            return false;
+        }
+        hit.Id = (uint64_t)buffer.block.actor;
+        hit.Postion = Vector3{ buffer.block.position.x, buffer.block.position.y, buffer.block.position.z };
+        hit.Normal = Vector3{ buffer.block.normal.x, buffer.block.normal.y, buffer.block.normal.z };
+        hit.Distance = buffer.block.distance;
+        return true;
+    }
+
+    void PhysxSceneImpl::EnableHistory(unsigned frames) {
+        mHistory.Reset(frames);
+    }
+
+    float PhysxSceneImpl::GetSimulationTime() {
+        // written by simulate under the write lock
+        SCENE_READ_LOCK();
+        return mSimTime;
+    }
+
+    bool PhysxSceneImpl::RaycastAt(float time, const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) {
+        return mHistory.Raycast(time, origin, unitDir, distance, hit);
+    }
+
+    bool PhysxSceneImpl::IsInitState() {
+        SCENE_READ_LOCK();
+        return mPhysicsActors.empty() && !mSceneInfo
+            && mFixedStep == 0.0f && mMaxSubSteps == DEFAULT_MAX_SUB_STEPS
+            && mMaterials.size() == 1 && mMaterial == mMaterials[0]
+            && mAngularDamping == DEFAULT_ANGULAR_DAMPING
+            && !mHistory.Enabled() && !mInterest.Enabled();
+    }
+
+    void PhysxSceneImpl::SetFixedTimestep(float step, unsigned maxSubSteps) {
+        SCENE_LOCK();
+        mFixedStep = step > 0.0f ? step : 0.0f;
+        mMaxSubSteps = maxSubSteps > 0 ? maxSubSteps : 1;
+        mAccumulator = 0.0f;
+        mInterpolation.clear();
+    }
+
+    float PhysxSceneImpl::GetInterpolationAlpha() {
+        SCENE_READ_LOCK();
+        return interpolationAlpha();
+    }
+
+    float PhysxSceneImpl::interpolationAlpha() {
+        if (mFixedStep <= 0.0f) {
+            return 1.0f;
         }
+        return mAccumulator / mFixedStep;
+    }
+
+    physx::PxTransform PhysxSceneImpl::GetInterpolatedPose(physx::PxRigidActor* actor) {
+        SCENE_READ_LOCK();
+        auto it = mInterpolation.find(actor);
+        if (it == mInterpolation.end() || it->second.Step != mStepCount) {
+            // not moved by the last step, or teleported since: the live pose is exact
+            return actor->getGlobalPose();
+        }
+        auto &state = it->second;
+        float alpha = interpolationAlpha();
+        physx::PxTransform pose;
+        pose.p = state.Prev.p + (state.Curr.p - state.Prev.p) * alpha;
+        physx::PxQuat to = state.Prev.q.dot(state.Curr.q) < 0.0f ? -state.Curr.q : state.Curr.q;
+        pose.q = (state.Prev.q * (1.0f - alpha) + to * alpha).getNormalized();
+        return pose;
     }
 
     physx::PxRigidActor* PhysxSceneImpl::CreatePlane(float xNormal, float yNormal, float zNormal, float distance) {
@@ -150,7 +485,7 @@ namespace PhysxWrap {
             return nullptr;
         }
         mScene->addActor(*plane);
-        mPhysicsActors[plane] = 1;
+        addPhysicsActor(plane, eRuntimeActor);
         return plane;
     }
 
@@ -160,10 +495,55 @@ namespace PhysxWrap {
             ERROR("[physx] creating heightfield geometry failed");
             return nullptr;
         }
-        return CreateHeightField(hfGeom);
+        auto actor = CreateHeightField(hfGeom);
+        hfGeom.heightField->release();  // the shape holds its own reference
+        addHeightField(actor);
+        return actor;
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateHeightField(const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale, const std::vector<uint8_t> &cellMaterials, const std::vector<Material> &materials) {
+        if (materials.empty() || materials.size() >= eTerrainHole) {
+            ERROR("[physx] heightfield needs 1..%d materials, got %u", eTerrainHole - 1, unsigned(materials.size()));
+            return nullptr;
+        }
+        for (size_t i = 0; i < cellMaterials.size(); i++) {
+            if (cellMaterials[i] >= materials.size() && cellMaterials[i] != eTerrainHole) {
+                ERROR("[physx] heightfield cell material out of range. index = %u", unsigned(cellMaterials[i]));
+                return nullptr;
+            }
+        }
+        physx::PxHeightFieldGeometry hfGeom;
+        if (GetHeightFieldGeometry(hfGeom, heightmap, columns, rows, scale, &cellMaterials) == false) {
+            ERROR("[physx] creating heightfield geometry failed");
+            return nullptr;
+        }
+        std::vector<physx::PxMaterial*> pxMaterials;
+        for (size_t i = 0; i < materials.size(); i++) {
+            auto material = gPhysxSDKImpl->GetPhysics()->createMaterial(materials[i].StaticFriction, materials[i].DynamicFriction, materials[i].Restitution);
+            if (!material) {
+                ERROR("[physx] createMaterial failed!");
+                break;
+            }
+            pxMaterials.push_back(material);
+        }
+        physx::PxRigidActor* actor = nullptr;
+        if (pxMaterials.size() == materials.size()) {
+            actor = CreateHeightField(hfGeom, pxMaterials);
+        }
+        // the shape holds its own references
+        for (size_t i = 0; i < pxMaterials.size(); i++) {
+            pxMaterials[i]->release();
+        }
+        hfGeom.heightField->release();
+        addHeightField(actor);
+        return actor;
     }
 
     physx::PxRigidActor* PhysxSceneImpl::CreateHeightField(const physx::PxHeightFieldGeometry &hfGeom) {
+        return CreateHeightField(hfGeom, std::vector<physx::PxMaterial*>());
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateHeightField(const physx::PxHeightFieldGeometry &hfGeom, const std::vector<physx::PxMaterial*> &materials) {
         SCENE_LOCK();
         auto columns = hfGeom.heightField->getNbColumns();
         auto rows = hfGeom.heightField->getNbRows();
@@ -174,19 +554,21 @@ namespace PhysxWrap {
             ERROR("[physx] creating heightfield actor failed");
             return nullptr;
         }
-        physx::PxShape* hfShape = physx::PxRigidActorExt::createExclusiveShape(*hfActor, hfGeom, *mMaterial);
+        physx::PxShape* hfShape = materials.empty()
+            ? physx::PxRigidActorExt::createExclusiveShape(*hfActor, hfGeom, *mMaterial)
+            : physx::PxRigidActorExt::createExclusiveShape(*hfActor, hfGeom, materials.data(), physx::PxU16(materials.size()));
         if (!hfShape) {
             ERROR("[physx] creating heightfield shape failed");
             return nullptr;
         }
         mScene->addActor(*hfActor);
-        mPhysicsActors[hfActor] = 1;
+        addPhysicsActor(hfActor, eRuntimeActor);
         return hfActor;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateBoxDynamic(const Vector3 &pos, const Vector3 &halfExtents, float density) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateBoxDynamic(const Vector3 &pos, const Vector3 &halfExtents, const BodyDesc &body) {
         SCENE_LOCK();
-        physx::PxRigidDynamic* box = PxCreateDynamic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxBoxGeometry(halfExtents.X, halfExtents.Y, halfExtents.Z), *mMaterial, density);
+        physx::PxRigidDynamic* box = PxCreateDynamic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxBoxGeometry(halfExtents.X, halfExtents.Y, halfExtents.Z), *getMaterial(body.Material), creationDensity(body));
         if (!box) {
             ERROR("[physx] create dynamic box failed!");
             return nullptr;
@@ -196,38 +578,40 @@ namespace PhysxWrap {
 #else
         DEFAULT_RIGID_DYNAMIC(box);
 #endif
+        applyMass(box, body);
         mScene->addActor(*box);
-        mPhysicsActors[box] = 1;
+        addPhysicsActor(box, eRuntimeActor);
         return box;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateBoxKinematic(const Vector3 &pos, const Vector3 &halfExtents, float density) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateBoxKinematic(const Vector3 &pos, const Vector3 &halfExtents, const BodyDesc &body) {
         SCENE_LOCK();
-        physx::PxRigidDynamic* box = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxBoxGeometry(halfExtents.X, halfExtents.Y, halfExtents.Z), *mMaterial, density);
+        physx::PxRigidDynamic* box = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxBoxGeometry(halfExtents.X, halfExtents.Y, halfExtents.Z), *getMaterial(body.Material), creationDensity(body));
         if (!box) {
             ERROR("[physx] create kinematic box failed!");
             return nullptr;
         }
+        applyMass(box, body);
         mScene->addActor(*box);
-        mPhysicsActors[box] = 1;
+        addPhysicsActor(box, eRuntimeActor);
         return box;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateBoxStatic(const Vector3 &pos, const Vector3 &halfExtents) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateBoxStatic(const Vector3 &pos, const Vector3 &halfExtents, unsigned material) {
         SCENE_LOCK();
-        physx::PxRigidStatic* box = PxCreateStatic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxBoxGeometry(halfExtents.X, halfExtents.Y, halfExtents.Z), *mMaterial);
+        physx::PxRigidStatic* box = PxCreateStatic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxBoxGeometry(halfExtents.X, halfExtents.Y, halfExtents.Z), *getMaterial(material));
         if (!box) {
             ERROR("[physx] create static box failed!");
             return nullptr;
         }
         mScene->addActor(*box);
-        mPhysicsActors[box] = 1;
+        addPhysicsActor(box, eRuntimeActor);
         return box;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateSphereDynamic(const Vector3 &pos, float radius, float density) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateSphereDynamic(const Vector3 &pos, float radius, const BodyDesc &body) {
         SCENE_LOCK();
-        physx::PxRigidDynamic* sphere = PxCreateDynamic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxSphereGeometry(radius), *mMaterial, density);
+        physx::PxRigidDynamic* sphere = PxCreateDynamic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxSphereGeometry(radius), *getMaterial(body.Material), creationDensity(body));
         if (!sphere) {
             ERROR("[physx] create dynamic sphere failed!");
             return nullptr;
@@ -237,38 +621,40 @@ namespace PhysxWrap {
 #else
         DEFAULT_RIGID_DYNAMIC(sphere);
 #endif
+        applyMass(sphere, body);
         mScene->addActor(*sphere);
-        mPhysicsActors[sphere] = 1;
+        addPhysicsActor(sphere, eRuntimeActor);
         return sphere;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateSphereKinematic(const Vector3 &pos, float radius, float density) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateSphereKinematic(const Vector3 &pos, float radius, const BodyDesc &body) {
         SCENE_LOCK();
-        physx::PxRigidDynamic* sphere = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxSphereGeometry(radius), *mMaterial, density);
+        physx::PxRigidDynamic* sphere = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxSphereGeometry(radius), *getMaterial(body.Material), creationDensity(body));
         if (!sphere) {
             ERROR("[physx] create kinematic sphere failed!");
             return nullptr;
         }
+        applyMass(sphere, body);
         mScene->addActor(*sphere);
-        mPhysicsActors[sphere] = 1;
+        addPhysicsActor(sphere, eRuntimeActor);
         return sphere;
     }
 
-    physx::PxRigidActor*  PhysxSceneImpl::CreateSphereStatic(const Vector3 &pos, float radius) {
+    physx::PxRigidActor*  PhysxSceneImpl::CreateSphereStatic(const Vector3 &pos, float radius, unsigned material) {
         SCENE_LOCK();
-        physx::PxRigidStatic* sphere = PxCreateStatic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxSphereGeometry(radius), *mMaterial);
+        physx::PxRigidStatic* sphere = PxCreateStatic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxSphereGeometry(radius), *getMaterial(material));
         if (!sphere) {
             ERROR("[physx] create static sphere failed!");
             return nullptr;
         }
         mScene->addActor(*sphere);
-        mPhysicsActors[sphere] = 1;
+        addPhysicsActor(sphere, eRuntimeActor);
         return sphere;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateCapsuleDynamic(const Vector3 &pos, float radius, float halfHeight, float density) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateCapsuleDynamic(const Vector3 &pos, float radius, float halfHeight, const BodyDesc &body) {
         SCENE_LOCK();
-        physx::PxRigidDynamic* capsule = PxCreateDynamic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxCapsuleGeometry(radius, halfHeight), *mMaterial, density);
+        physx::PxRigidDynamic* capsule = PxCreateDynamic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxCapsuleGeometry(radius, halfHeight), *getMaterial(body.Material), creationDensity(body));
         if (!capsule) {
             ERROR("[physx] create dynamic capsule failed!");
             return nullptr;
@@ -278,86 +664,410 @@ namespace PhysxWrap {
 #else
         DEFAULT_RIGID_DYNAMIC(capsule);
 #endif
+        applyMass(capsule, body);
         mScene->addActor(*capsule);
-        mPhysicsActors[capsule] = 1;
+        addPhysicsActor(capsule, eRuntimeActor);
         return capsule;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateCapsuleKinematic(const Vector3 &pos, float radius, float halfHeight, float density) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateCapsuleKinematic(const Vector3 &pos, float radius, float halfHeight, const BodyDesc &body) {
         SCENE_LOCK();
-        physx::PxRigidDynamic* capsule = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxCapsuleGeometry(radius, halfHeight), *mMaterial, density);
+        physx::PxRigidDynamic* capsule = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxCapsuleGeometry(radius, halfHeight), *getMaterial(body.Material), creationDensity(body));
         if (!capsule) {
             ERROR("[physx] create kinematic capsule failed!");
             return nullptr;
         }
+        applyMass(capsule, body);
         mScene->addActor(*capsule);
-        mPhysicsActors[capsule] = 1;
+        addPhysicsActor(capsule, eRuntimeActor);
         return capsule;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateCapsuleStatic(const Vector3 &pos, float radius, float halfHeight) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateCapsuleStatic(const Vector3 &pos, float radius, float halfHeight, unsigned material) {
         SCENE_LOCK();
-        physx::PxRigidStatic* capsule = PxCreateStatic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxCapsuleGeometry(radius, halfHeight), *mMaterial);
+        physx::PxRigidStatic* capsule = PxCreateStatic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxCapsuleGeometry(radius, halfHeight), *getMaterial(material));
         if (!capsule) {
             ERROR("[physx] create static capsule failed!");
             return nullptr;
         }
         mScene->addActor(*capsule);
-        mPhysicsActors[capsule] = 1;
+        addPhysicsActor(capsule, eRuntimeActor);
         return capsule;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, float density) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateConvexDynamic(const Vector3 &pos, const std::vector<float> &points, unsigned vertexLimit, const BodyDesc &body) {
+        physx::PxConvexMesh* convexMesh = gMeshRegistry->GetConvex(points, vertexLimit);
+        if (!convexMesh) {
+            return nullptr;
+        }
+        SCENE_LOCK();
+        physx::PxRigidDynamic* convex = PxCreateDynamic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxConvexMeshGeometry(convexMesh), *getMaterial(body.Material), creationDensity(body));
+        if (!convex) {
+            ERROR("[physx] create dynamic convex failed!");
+            return nullptr;
+        }
+#ifdef _DEBUG
+        DEFAULT_RIGID_DYNAMIC_DEBUG(convex);
+#else
+        DEFAULT_RIGID_DYNAMIC(convex);
+#endif
+        applyMass(convex, body);
+        mScene->addActor(*convex);
+        addPhysicsActor(convex, eRuntimeActor);
+        return convex;
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateConvexKinematic(const Vector3 &pos, const std::vector<float> &points, unsigned vertexLimit, const BodyDesc &body) {
+        physx::PxConvexMesh* convexMesh = gMeshRegistry->GetConvex(points, vertexLimit);
+        if (!convexMesh) {
+            return nullptr;
+        }
+        SCENE_LOCK();
+        physx::PxRigidDynamic* convex = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), physx::PxConvexMeshGeometry(convexMesh), *getMaterial(body.Material), creationDensity(body));
+        if (!convex) {
+            ERROR("[physx] create kinematic convex failed!");
+            return nullptr;
+        }
+        applyMass(convex, body);
+        mScene->addActor(*convex);
+        addPhysicsActor(convex, eRuntimeActor);
+        return convex;
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, const BodyDesc &body) {
+        return createMeshKinematic(pos, scale, vb, ib, body);
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib, const BodyDesc &body) {
+        return createMeshKinematic(pos, scale, vb, ib, body);
+    }
+
+    template<typename T>
+    physx::PxRigidActor* PhysxSceneImpl::createMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<T> &ib, const BodyDesc &body) {
         physx::PxTriangleMeshGeometry triGeom;
         if (GetMeshGeometry(triGeom, pos, scale, vb, ib) == false) {
             return nullptr;
         }
-        return CreateMeshKinematic(pos, triGeom, density);
+        auto actor = CreateMeshKinematic(pos, triGeom, body);
+        // the shape holds its own reference
+        triGeom.triangleMesh->release();
+        return actor;
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateMeshKinematic(uint64_t meshId, const Vector3 &pos, const Quat &rotate, const Vector3 &scale, const BodyDesc &body) {
+        physx::PxTriangleMesh* triangleMesh = gMeshRegistry->Get(meshId);
+        if (!triangleMesh) {
+            ERROR("[physx] unknown mesh id %llu", (unsigned long long)meshId);
+            return nullptr;
+        }
+        physx::PxTriangleMeshGeometry triGeom(triangleMesh, physx::PxMeshScale(physx::PxVec3{ scale.X, scale.Y, scale.Z }, physx::PxQuat(physx::PxIdentity)));
+        auto actor = CreateMeshKinematic(pos, triGeom, body);
+        SetGlobalRotate(actor, rotate);
+        return actor;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateMeshKinematic(const Vector3 &pos, const physx::PxTriangleMeshGeometry &triGeom, float density) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateMeshKinematic(const Vector3 &pos, const physx::PxTriangleMeshGeometry &triGeom, const BodyDesc &body) {
         SCENE_LOCK();
-        physx::PxRigidDynamic* mesh = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), triGeom, *mMaterial, density);
+        physx::PxRigidDynamic* mesh = PxCreateKinematic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), triGeom, *getMaterial(body.Material), creationDensity(body));
         if (!mesh) {
             ERROR("[physx] create kinematic mesh failed!");
             return nullptr;
         }
+        applyMass(mesh, body);
         mScene->addActor(*mesh);
-        mPhysicsActors[mesh] = 1;
+        addPhysicsActor(mesh, eRuntimeActor);
         return mesh;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, unsigned material) {
+        return createMeshStatic(pos, scale, vb, ib, material);
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib, unsigned material) {
+        return createMeshStatic(pos, scale, vb, ib, material);
+    }
+
+    template<typename T>
+    physx::PxRigidActor* PhysxSceneImpl::createMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<T> &ib, unsigned material) {
         physx::PxTriangleMeshGeometry triGeom;
         if (GetMeshGeometry(triGeom, pos, scale, vb, ib) == false) {
             return nullptr;
         }
-        return CreateMeshStatic(pos, triGeom);
+        auto actor = CreateMeshStatic(pos, triGeom, material);
+        // the shape holds its own reference
+        triGeom.triangleMesh->release();
+        return actor;
     }
 
-    physx::PxRigidActor* PhysxSceneImpl::CreateMeshStatic(const Vector3 &pos, const physx::PxTriangleMeshGeometry &triGeom) {
+    physx::PxRigidActor* PhysxSceneImpl::CreateMeshStatic(uint64_t meshId, const Vector3 &pos, const Quat &rotate, const Vector3 &scale, unsigned material) {
+        physx::PxTriangleMesh* triangleMesh = gMeshRegistry->Get(meshId);
+        if (!triangleMesh) {
+            ERROR("[physx] unknown mesh id %llu", (unsigned long long)meshId);
+            return nullptr;
+        }
+        physx::PxTriangleMeshGeometry triGeom(triangleMesh, physx::PxMeshScale(physx::PxVec3{ scale.X, scale.Y, scale.Z }, physx::PxQuat(physx::PxIdentity)));
+        auto actor = CreateMeshStatic(pos, triGeom, material);
+        SetGlobalRotate(actor, rotate);
+        return actor;
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateMeshStatic(const Vector3 &pos, const physx::PxTriangleMeshGeometry &triGeom, unsigned material) {
         SCENE_LOCK();
-        physx::PxRigidStatic* mesh = PxCreateStatic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), triGeom, *mMaterial);
+        physx::PxRigidStatic* mesh = PxCreateStatic(*gPhysxSDKImpl->GetPhysics(), physx::PxTransform(pos.X, pos.Y, pos.Z), triGeom, *getMaterial(material));
         if (!mesh) {
             ERROR("[physx] create static mesh failed!");
             return nullptr;
         }
         mScene->addActor(*mesh);
-        mPhysicsActors[mesh] = 1;
+        addPhysicsActor(mesh, eRuntimeActor);
         return mesh;
     }
 
+    physx::PxRigidActor* PhysxSceneImpl::CreateCompoundDynamic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body) {
+        return createCompoundDynamic(pos, rotate, shapes, body, false);
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateCompoundKinematic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body) {
+        return createCompoundDynamic(pos, rotate, shapes, body, true);
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::createCompoundDynamic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body, bool kinematic) {
+        SCENE_LOCK();
+        physx::PxTransform pose(physx::PxVec3(pos.X, pos.Y, pos.Z), physx::PxQuat(rotate.X, rotate.Y, rotate.Z, rotate.W));
+        physx::PxRigidDynamic* compound = gPhysxSDKImpl->GetPhysics()->createRigidDynamic(pose);
+        if (!compound) {
+            ERROR("[physx] create compound failed!");
+            return nullptr;
+        }
+        if (!attachShapes(compound, shapes, body.Material)) {
+            compound->release();
+            return nullptr;
+        }
+        if (kinematic) {
+            compound->setRigidBodyFlag(physx::PxRigidBodyFlag::eKINEMATIC, true);
+        }
+        else {
+#ifdef _DEBUG
+            DEFAULT_RIGID_DYNAMIC_DEBUG(compound);
+#else
+            DEFAULT_RIGID_DYNAMIC(compound);
+#endif
+        }
+        if (body.Mass > 0.0f) {
+            applyMass(compound, body);
+        }
+        else {
+            physx::PxRigidBodyExt::updateMassAndInertia(*compound, body.Density);
+        }
+        mScene->addActor(*compound);
+        addPhysicsActor(compound, eRuntimeActor);
+        return compound;
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateCompoundStatic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes) {
+        SCENE_LOCK();
+        physx::PxTransform pose(physx::PxVec3(pos.X, pos.Y, pos.Z), physx::PxQuat(rotate.X, rotate.Y, rotate.Z, rotate.W));
+        physx::PxRigidStatic* compound = gPhysxSDKImpl->GetPhysics()->createRigidStatic(pose);
+        if (!compound) {
+            ERROR("[physx] create static compound failed!");
+            return nullptr;
+        }
+        if (!attachShapes(compound, shapes, eCurrentMaterial)) {
+            compound->release();
+            return nullptr;
+        }
+        mScene->addActor(*compound);
+        addPhysicsActor(compound, eRuntimeActor);
+        return compound;
+    }
+
+    bool PhysxSceneImpl::attachShapes(physx::PxRigidActor* actor, const std::vector<ShapeDesc> &shapes, unsigned material) {
+        if (shapes.empty()) {
+            ERROR("[physx] compound without shapes");
+            return false;
+        }
+        for (size_t i = 0; i < shapes.size(); i++) {
+            auto &desc = shapes[i];
+            auto shapeMaterial = getMaterial(desc.Material != eCurrentMaterial ? desc.Material : material);
+            physx::PxShape* shape = nullptr;
+            switch (desc.Type) {
+            case eShapeBox:
+            {
+                physx::PxBoxGeometry geom(desc.HalfExtents.X, desc.HalfExtents.Y, desc.HalfExtents.Z);
+                if (geom.isValid()) {
+                    shape = physx::PxRigidActorExt::createExclusiveShape(*actor, geom, *shapeMaterial);
+                }
+                break;
+            }
+            case eShapeSphere:
+            {
+                physx::PxSphereGeometry geom(desc.Radius);
+                if (geom.isValid()) {
+                    shape = physx::PxRigidActorExt::createExclusiveShape(*actor, geom, *shapeMaterial);
+                }
+                break;
+            }
+            case eShapeCapsule:
+            {
+                physx::PxCapsuleGeometry geom(desc.Radius, desc.HalfHeight);
+                if (geom.isValid()) {
+                    shape = physx::PxRigidActorExt::createExclusiveShape(*actor, geom, *shapeMaterial);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+            if (!shape) {
+                ERROR("[physx] create compound shape %u failed. type=%d", unsigned(i), desc.Type);
+                return false;
+            }
+            shape->setLocalPose(physx::PxTransform(physx::PxVec3(desc.Postion.X, desc.Postion.Y, desc.Postion.Z), physx::PxQuat(desc.Rotate.X, desc.Rotate.Y, desc.Rotate.Z, desc.Rotate.W)));
+        }
+        return true;
+    }
+
+    physx::PxAggregate* PhysxSceneImpl::CreateAggregate(unsigned maxActors, bool selfCollision) {
+        if (mScene == nullptr) {
+            return nullptr;
+        }
+        if (maxActors == 0 || maxActors > MAX_AGGREGATE_ACTORS) {
+            ERROR("[physx] aggregate size must be 1..%d. maxActors=%u", MAX_AGGREGATE_ACTORS, maxActors);
+            return nullptr;
+        }
+        SCENE_LOCK();
+        auto aggregate = gPhysxSDKImpl->GetPhysics()->createAggregate(maxActors, selfCollision);
+        if (!aggregate) {
+            ERROR("[physx] createAggregate failed!");
+            return nullptr;
+        }
+        mScene->addAggregate(*aggregate);
+        mAggregates.insert(aggregate);
+        return aggregate;
+    }
+
+    bool PhysxSceneImpl::AddToAggregate(physx::PxAggregate* aggregate, physx::PxRigidActor* actor) {
+        if (mAggregates.find(aggregate) == mAggregates.end()) {
+            ERROR("[physx] unknown aggregate");
+            return false;
+        }
+        auto it = mPhysicsActors.find(actor);
+        if (it == mPhysicsActors.end() || it->second == eControllerActor) {
+            ERROR("[physx] actor can't be aggregated");
+            return false;
+        }
+        if (actor->getAggregate() != nullptr) {
+            ERROR("[physx] actor already belongs to an aggregate");
+            return false;
+        }
+        SCENE_LOCK();
+        // an actor joins the scene through its aggregate
+        mScene->removeActor(*actor, false);
+        if (!aggregate->addActor(*actor)) {
+            ERROR("[physx] aggregate full. maxActors=%u", aggregate->getMaxNbActors());
+            mScene->addActor(*actor);
+            return false;
+        }
+        return true;
+    }
+
+    void PhysxSceneImpl::RemoveAggregate(physx::PxAggregate* aggregate) {
+        auto it = mAggregates.find(aggregate);
+        if (it == mAggregates.end()) {
+            return;
+        }
+        SCENE_LOCK();
+        // PhysX puts the aggregated actors back into the scene
+        aggregate->release();
+        mAggregates.erase(it);
+    }
+
+    physx::PxRigidActor* PhysxSceneImpl::CreateCapsuleController(const Vector3 &pos, float radius, float halfHeight, float stepOffset, float slopeLimit) {
+        if (mScene == nullptr) {
+            return nullptr;
+        }
+        SCENE_LOCK();
+        if (mControllerManager == nullptr) {
+            mControllerManager = PxCreateControllerManager(*mScene);
+            if (!mControllerManager) {
+                ERROR("[physx] PxCreateControllerManager failed!");
+                return nullptr;
+            }
+        }
+        physx::PxCapsuleControllerDesc desc;
+        desc.position = physx::PxExtendedVec3(pos.X, pos.Y, pos.Z);
+        desc.radius = radius;
+        desc.height = halfHeight * 2.0f;
+        desc.stepOffset = stepOffset;
+        desc.slopeLimit = slopeLimit > 0.0f ? std::cos(slopeLimit * physx::PxPi / 180.0f) : 0.0f;
+        desc.material = mMaterial;
+        if (!desc.isValid()) {
+            ERROR("[physx] invalid capsule controller. radius=%f halfHeight=%f stepOffset=%f", radius, halfHeight, stepOffset);
+            return nullptr;
+        }
+        auto controller = mControllerManager->createController(desc);
+        if (!controller) {
+            ERROR("[physx] createController failed!");
+            return nullptr;
+        }
+        physx::PxRigidActor* actor = controller->getActor();
+        addPhysicsActor(actor, eControllerActor);
+        mControllers[actor] = controller;
+        return actor;
+    }
+
+    void PhysxSceneImpl::MoveControllers(const uint64_t *ids, const Vector3 *displacements, unsigned count, float elapsedTime, uint8_t *outFlags) {
+        if (mScene == nullptr) {
+            return;
+        }
+        SCENE_LOCK();
+        physx::PxControllerFilters filters;
+        for (unsigned i = 0; i < count; i++) {
+            auto it = mControllers.find((physx::PxRigidActor*)ids[i]);
+            if (it == mControllers.end()) {
+                if (outFlags) {
+                    outFlags[i] = 0;
+                }
+                continue;
+            }
+            auto &disp = displacements[i];
+            auto flags = it->second->move(physx::PxVec3(disp.X, disp.Y, disp.Z), CONTROLLER_MIN_MOVE, elapsedTime, filters);
+            if (outFlags) {
+                outFlags[i] = uint8_t(flags);
+            }
+            if (mInterest.Enabled()) {
+                // query-only scenes never report controllers as active
+                auto pos = it->second->getPosition();
+                mInterest.Update(ids[i], float(pos.x), float(pos.z));
+            }
+        }
+    }
+
     void PhysxSceneImpl::RemoveActor(physx::PxRigidActor* actor) {
+        SCENE_LOCK();
         auto it = mPhysicsActors.find(actor);
         if (it != mPhysicsActors.end()) {
-            if (it->first != 0) {
+            if (it->second == eControllerActor) {
+                auto controller = mControllers.find(actor);
+                controller->second->release();
+                mControllers.erase(controller);
+            }
+            else if (it->first != 0) {
                 it->first->release();
             }
             mPhysicsActors.erase(it);
+            mInterpolation.erase(actor);
+            mInterest.Remove((uint64_t)actor);
+            auto hf = std::find(mHeightFields.begin(), mHeightFields.end(), actor);
+            if (hf != mHeightFields.end()) {
+                mHeightFields.erase(hf);
+                mTerrainDirty = true;
+            }
         }
     }
 
     void PhysxSceneImpl::SetLinearVelocity(physx::PxRigidActor* actor, const Vector3 &velocity) {
+        SCENE_LOCK();
         if (actor == 0)
         {
             return;
@@ -369,6 +1079,7 @@ namespace PhysxWrap {
     }
 
     void PhysxSceneImpl::AddForce(physx::PxRigidActor* actor, const Vector3 &force) {
+        SCENE_LOCK();
         if (actor == 0)
         {
             return;
@@ -380,6 +1091,7 @@ namespace PhysxWrap {
     }
 
     void PhysxSceneImpl::ClearForce(physx::PxRigidActor* actor) {
+        SCENE_LOCK();
         if (actor == 0)
         {
             return;
@@ -391,15 +1103,25 @@ namespace PhysxWrap {
     }
 
     Vector3 PhysxSceneImpl::GetGlobalPostion(physx::PxRigidActor* actor) {
+        SCENE_READ_LOCK();
         if (actor == 0)
         {
             return Vector3{};
         }
+        if (!mControllers.empty()) {
+            // the actor only reaches the controller's postion at the next simulation step
+            auto it = mControllers.find(actor);
+            if (it != mControllers.end()) {
+                auto &p = it->second->getPosition();
+                return Vector3{ float(p.x), float(p.y), float(p.z) };
+            }
+        }
         auto pose = actor->getGlobalPose();
         return Vector3{ pose.p.x, pose.p.y, pose.p.z };
     }
 
     Quat PhysxSceneImpl::GetGlobalRotate(physx::PxRigidActor* actor) {
+        SCENE_READ_LOCK();
         if (actor == 0)
         {
             return Quat{};
@@ -409,18 +1131,36 @@ namespace PhysxWrap {
     }
 
     void PhysxSceneImpl::SetGlobalPostion(physx::PxRigidActor* actor, const Vector3 &pos) {
+        SCENE_LOCK();
         if (actor == 0)
         {
             return;
         }
+        if (!mControllers.empty()) {
+            auto it = mControllers.find(actor);
+            if (it != mControllers.end()) {
+                it->second->setPosition(physx::PxExtendedVec3(pos.X, pos.Y, pos.Z));
+                mInterpolation.erase(actor);
+                if (mInterest.Enabled()) {
+                    mInterest.Update((uint64_t)actor, pos.X, pos.Z);
+                }
+                return;
+            }
+        }
         auto pose = actor->getGlobalPose();
         pose.p.x = pos.X;
         pose.p.y = pos.Y;
         pose.p.z = pos.Z;
         actor->setGlobalPose(pose);
+        mInterpolation.erase(actor);
+        auto tracked = mPhysicsActors.find(actor);
+        if (mInterest.Enabled() && tracked != mPhysicsActors.end() && tracked->second != eSceneInfoActor) {
+            mInterest.Update((uint64_t)actor, pos.X, pos.Z);
+        }
     }
 
     void PhysxSceneImpl::SetGlobalRotate(physx::PxRigidActor* actor, const Quat &rotate) {
+        SCENE_LOCK();
         if (actor == 0)
         {
             return;
@@ -431,9 +1171,11 @@ namespace PhysxWrap {
         pose.q.z = rotate.Z;
         pose.q.w = rotate.W;
         actor->setGlobalPose(pose);
+        mInterpolation.erase(actor);
     }
 
     bool PhysxSceneImpl::IsStaticObj(physx::PxRigidActor* actor) {
+        SCENE_READ_LOCK();
         if (actor == 0)
         {
             return false;
@@ -442,6 +1184,7 @@ namespace PhysxWrap {
     }
 
     bool PhysxSceneImpl::IsDynamicObj(physx::PxRigidActor* actor) {
+        SCENE_READ_LOCK();
         if (actor == 0)
         {
             return false;
@@ -449,11 +1192,117 @@ namespace PhysxWrap {
         return actor->getType() == physx::PxActorType::eRIGID_DYNAMIC;
     }
 
+    bool PhysxSceneImpl::SetTrigger(physx::PxRigidActor* actor, bool trigger) {
+        if (actor == 0) {
+            return false;
+        }
+        SCENE_LOCK();
+        std::vector<physx::PxShape*> shapes(actor->getNbShapes());
+        physx::PxU32 count = actor->getShapes(shapes.data(), physx::PxU32(shapes.size()));
+        for (physx::PxU32 i = 0; i < count; i++) {
+            auto type = shapes[i]->getGeometryType();
+            if (trigger && (type == physx::PxGeometryType::eTRIANGLEMESH || type == physx::PxGeometryType::eHEIGHTFIELD || type == physx::PxGeometryType::ePLANE)) {
+                ERROR("[physx] trigger shapes must be primitives or convex meshes");
+                return false;
+            }
+        }
+        for (physx::PxU32 i = 0; i < count; i++) {
+            // the two flags must never be set together
+            if (trigger) {
+                shapes[i]->setFlag(physx::PxShapeFlag::eSIMULATION_SHAPE, false);
+                shapes[i]->setFlag(physx::PxShapeFlag::eTRIGGER_SHAPE, true);
+            }
+            else {
+                shapes[i]->setFlag(physx::PxShapeFlag::eTRIGGER_SHAPE, false);
+                shapes[i]->setFlag(physx::PxShapeFlag::eSIMULATION_SHAPE, true);
+            }
+        }
+        return true;
+    }
+
+    void PhysxSceneImpl::EnableContactEvents(physx::PxRigidActor* actor, bool enable) {
+        if (actor == 0) {
+            return;
+        }
+        SCENE_LOCK();
+        std::vector<physx::PxShape*> shapes(actor->getNbShapes());
+        physx::PxU32 count = actor->getShapes(shapes.data(), physx::PxU32(shapes.size()));
+        for (physx::PxU32 i = 0; i < count; i++) {
+            physx::PxFilterData data = shapes[i]->getSimulationFilterData();
+            if (enable) {
+                data.word3 |= eFilterReportContacts;
+            }
+            else {
+                data.word3 &= ~physx::PxU32(eFilterReportContacts);
+            }
+            shapes[i]->setSimulationFilterData(data);
+        }
+        if (actor->getScene()) {
+            mScene->resetFiltering(*actor);
+        }
+    }
+
+    void PhysxSceneImpl::SetEventCapacity(unsigned capacity) {
+        mEvents.SetCapacity(capacity);
+    }
+
+    unsigned PhysxSceneImpl::DrainEvents(PhysicsEvent *buffer, unsigned capacity) {
+        return mEvents.Drain(buffer, capacity);
+    }
+
+    unsigned PhysxSceneImpl::GetDroppedEvents() {
+        return mEvents.GetDropped();
+    }
+
+    unsigned PhysxSceneImpl::CreateMaterial(float staticFriction, float dynamicFriction, float restitution) {
+        auto material = gPhysxSDKImpl->GetPhysics()->createMaterial(staticFriction, dynamicFriction, restitution);
+        if (!material) {
+            ERROR("[physx] createMaterial failed!");
+            return eCurrentMaterial;
+        }
+        mMaterials.push_back(material);
+        unsigned index = unsigned(mMaterials.size() - 1);
+        mMaterialIndex.insert(std::make_pair(std::make_tuple(staticFriction, dynamicFriction, restitution), index));
+        return index;
+    }
+
+    void PhysxSceneImpl::SetCurrentMaterial(unsigned index) {
+        if (index >= mMaterials.size()) {
+            ERROR("[physx] unknown material index %u", index);
+            return;
+        }
+        mMaterial = mMaterials[index];
+    }
+
     void PhysxSceneImpl::SetCurrentMaterial(float staticFriction, float dynamicFriction, float restitution) {
-        if (mMaterial != nullptr) {
-            mMaterial->setStaticFriction(staticFriction);
-            mMaterial->setDynamicFriction(dynamicFriction);
-            mMaterial->setRestitution(restitution);
+        // actors keep the material they were created with, so pick or add a palette entry instead of editing mMaterial
+        auto it = mMaterialIndex.find(std::make_tuple(staticFriction, dynamicFriction, restitution));
+        if (it != mMaterialIndex.end()) {
+            mMaterial = mMaterials[it->second];
+            return;
+        }
+        SetCurrentMaterial(CreateMaterial(staticFriction, dynamicFriction, restitution));
+    }
+
+    physx::PxMaterial* PhysxSceneImpl::getMaterial(unsigned index) {
+        if (index == eCurrentMaterial) {
+            return mMaterial;
+        }
+        if (index >= mMaterials.size()) {
+            ERROR("[physx] unknown material index %u", index);
+            return mMaterial;
+        }
+        return mMaterials[index];
+    }
+
+    float PhysxSceneImpl::creationDensity(const BodyDesc &body) {
+        // PxCreateDynamic rejects a zero density even when the mass is set right after
+        return body.Mass > 0.0f ? 1.0f : body.Density;
+    }
+
+    void PhysxSceneImpl::applyMass(physx::PxRigidDynamic* actor, const BodyDesc &body) {
+        if (body.Mass > 0.0f) {
+            physx::PxRigidBodyExt::setMassAndUpdateInertia(*actor, body.Mass);
         }
     }
 
@@ -466,23 +1315,16 @@ namespace PhysxWrap {
         {
             return true;
         }
-        auto sceneInfo = gSceneInfoMgr->Get(path);
-        if (sceneInfo == nullptr)
-        {
-            sceneInfo = std::make_shared<SceneInfo>();
-            if (sceneInfo->Load(path)) {
-                gSceneInfoMgr->Set(path, sceneInfo);
-            }
-            else {
-                sceneInfo = nullptr;
-            }
-        }
+        auto sceneInfo = gSceneInfoMgr->GetOrLoad(path);
         if (sceneInfo != nullptr)
         {
+            mScenePath = path;
+            mSceneInfo = sceneInfo;
             for (size_t i = 0; i < sceneInfo->Terrains.size(); i++)
             {
                 auto &info = sceneInfo->Terrains[i];
-                auto actor = CreateHeightField(info.Geom);
+                auto actor = CreateHeightField(info.Geom, info.Materials);
+                markSceneInfoActor(actor);
                 SetGlobalPostion(actor, info.Postion);
                 SetGlobalRotate(actor, info.Rotate);
             }
@@ -490,27 +1332,441 @@ namespace PhysxWrap {
             {
                 auto &info = sceneInfo->Boxs[i];
                 auto actor = CreateBoxStatic(info.Postion, info.Half);
+                markSceneInfoActor(actor);
                 SetGlobalRotate(actor, info.Rotate);
             }
             for (size_t i = 0; i < sceneInfo->Capsules.size(); i++)
             {
                 auto &info = sceneInfo->Capsules[i];
                 auto actor = CreateCapsuleStatic(info.Postion, info.Radius, info.HalfHeight);
+                markSceneInfoActor(actor);
                 SetGlobalRotate(actor, info.Rotate);
             }
             for (size_t i = 0; i < sceneInfo->Meshs.size(); i++)
             {
                 auto &info = sceneInfo->Meshs[i];
                 auto actor = CreateMeshStatic(info.Postion, info.Geom);
+                markSceneInfoActor(actor);
                 SetGlobalRotate(actor, info.Rotate);
             }
             for (size_t i = 0; i < sceneInfo->Spheres.size(); i++)
             {
                 auto &info = sceneInfo->Spheres[i];
                 auto actor = CreateSphereStatic(info.Postion, info.Radius);
+                markSceneInfoActor(actor);
                 SetGlobalRotate(actor, info.Rotate);
             }
+            physx::PxU32 regionCount = 0;
+            if (mConfig.BroadPhase == eBroadPhaseMBP) {
+                SCENE_READ_LOCK();
+                regionCount = mScene->getNbBroadPhaseRegions();
+            }
+            if (mConfig.BroadPhase == eBroadPhaseMBP && regionCount == 0) {
+                physx::PxBounds3 bounds = physx::PxBounds3::empty();
+                {
+                    SCENE_READ_LOCK();
+                    for (auto it = mPhysicsActors.begin(); it != mPhysicsActors.end(); ++it) {
+                        if (it->second == eSceneInfoActor) {
+                            bounds.include(it->first->getWorldBounds());
+                        }
+                    }
+                }
+                if (!bounds.isEmpty()) {
+                    addBroadPhaseRegions(bounds);
+                }
+            }
         }
         return sceneInfo != nullptr;
     }
+
+    void PhysxSceneImpl::addBroadPhaseRegions(const physx::PxBounds3 &bounds) {
+        // regions are split on the ground plane only, leave room above and below the map
+        physx::PxBounds3 world = bounds;
+        world.minimum.y -= REGION_VERTICAL_MARGIN;
+        world.maximum.y += REGION_VERTICAL_MARGIN;
+        unsigned subdiv = mConfig.RegionSubdivisions;
+        subdiv = subdiv < 1 ? 1 : (subdiv > MAX_REGION_SUBDIVISIONS ? MAX_REGION_SUBDIVISIONS : subdiv);
+        std::vector<physx::PxBounds3> regions(subdiv * subdiv);
+        physx::PxU32 count = physx::PxBroadPhaseExt::createRegionsFromWorldBounds(regions.data(), world, subdiv);
+        SCENE_LOCK();
+        for (physx::PxU32 i = 0; i < count; i++) {
+            physx::PxBroadPhaseRegion region;
+            region.bounds = regions[i];
+            region.userData = nullptr;
+            // populate: actors added before the regions existed are picked up
+            mScene->addBroadPhaseRegion(region, true);
+        }
+    }
+
+    void PhysxSceneImpl::markSceneInfoActor(physx::PxRigidActor* actor) {
+        SCENE_LOCK();
+        auto it = mPhysicsActors.find(actor);
+        if (it != mPhysicsActors.end()) {
+            it->second = eSceneInfoActor;
+            mInterest.Remove((uint64_t)actor);
+        }
+    }
+
+    physx::PxBounds3 PhysxSceneImpl::captureBounds() {
+        // concurrent CaptureTransforms only share the read lock
+        std::lock_guard<std::mutex> lock(mCaptureMutex);
+        if (mCaptureBounds.isEmpty()) {
+            // the configured world bounds, else what is in the room now; must stay fixed so states can be diffed
+            const Vector3 &min = mConfig.WorldMin;
+            const Vector3 &max = mConfig.WorldMax;
+            if (min.X < max.X && min.Y < max.Y && min.Z < max.Z) {
+                mCaptureBounds = physx::PxBounds3(physx::PxVec3(min.X, min.Y, min.Z), physx::PxVec3(max.X, max.Y, max.Z));
+            }
+            else {
+                for (auto it = mPhysicsActors.begin(); it != mPhysicsActors.end(); ++it) {
+                    if (it->first->getType() != physx::PxActorType::eRIGID_STATIC || it->second == eSceneInfoActor) {
+                        mCaptureBounds.include(it->first->getWorldBounds());
+                    }
+                }
+                if (!mCaptureBounds.isEmpty()) {
+                    mCaptureBounds.fattenFast(REGION_VERTICAL_MARGIN);
+                }
+            }
+        }
+        return mCaptureBounds;
+    }
+
+    void PhysxSceneImpl::CaptureTransforms(std::vector<uint8_t> &state, unsigned positionBits) {
+        SCENE_READ_LOCK();
+        physx::PxBounds3 bounds = captureBounds();
+        std::vector<TransformCodec::Pose> poses;
+        poses.reserve(mPhysicsActors.size());
+        for (auto it = mPhysicsActors.begin(); it != mPhysicsActors.end(); ++it) {
+            if (it->first->getType() == physx::PxActorType::eRIGID_DYNAMIC) {
+                poses.push_back(TransformCodec::Pose{ (uint64_t)it->first, it->first->getGlobalPose() });
+            }
+        }
+        TransformCodec::Quantize(bounds, positionBits, poses, state);
+    }
+
+    void PhysxSceneImpl::addPhysicsActor(physx::PxRigidActor* actor, int type) {
+        mPhysicsActors[actor] = type;
+        if (mInterest.Enabled()) {
+            auto pos = actor->getGlobalPose().p;
+            mInterest.Update((uint64_t)actor, pos.x, pos.z);
+        }
+    }
+
+    void PhysxSceneImpl::EnableInterest(float cellSize) {
+        SCENE_LOCK();
+        mInterest.Reset(cellSize);
+        if (!mInterest.Enabled()) {
+            return;
+        }
+        for (auto it = mPhysicsActors.begin(); it != mPhysicsActors.end(); ++it) {
+            if (it->second != eSceneInfoActor) {
+                auto pos = it->first->getGlobalPose().p;
+                mInterest.Update((uint64_t)it->first, pos.x, pos.z);
+            }
+        }
+    }
+
+    void PhysxSceneImpl::QueryInterest(const Vector3 *observers, unsigned count, float radius, std::vector<uint64_t> &ids, std::vector<unsigned> &offsets) {
+        SCENE_READ_LOCK();
+        mInterest.Query(observers, count, radius, ids, offsets);
+    }
+
+    void PhysxSceneImpl::SampleTerrainHeights(const float *xz, unsigned count, float *heights, uint8_t *outHit) {
+        if (mScene == nullptr) {
+            memset(heights, 0, count * sizeof(float));
+            memset(outHit, 0, count);
+            return;
+        }
+        SCENE_READ_LOCK();
+        if (mSceneInfo) {
+            mSceneInfo->GetStaticWorld().GetTerrainSampler().Sample(xz, count, heights, outHit);
+        }
+        else {
+            memset(heights, 0, count * sizeof(float));
+            memset(outHit, TerrainSampler::eSampleMiss, count);
+        }
+        if (!mHeightFields.empty()) {
+            std::vector<float> runtimeHeights(count);
+            std::vector<uint8_t> runtimeState(count);
+            {
+                std::lock_guard<std::mutex> lock(mTerrainMutex);
+                refreshTerrainSampler();
+                mTerrainSampler.Sample(xz, count, runtimeHeights.data(), runtimeState.data());
+            }
+            for (unsigned i = 0; i < count; i++) {
+                if (outHit[i] == TerrainSampler::eSampleRaycast || runtimeState[i] == TerrainSampler::eSampleMiss) {
+                    continue;
+                }
+                if (runtimeState[i] == TerrainSampler::eSampleRaycast || outHit[i] == TerrainSampler::eSampleMiss || runtimeHeights[i] > heights[i]) {
+                    heights[i] = runtimeHeights[i];
+                    outHit[i] = runtimeState[i];
+                }
+            }
+        }
+
+        std::vector<unsigned> pending;
+        for (unsigned i = 0; i < count; i++) {
+            if (outHit[i] == TerrainSampler::eSampleRaycast) {
+                pending.push_back(i);
+            }
+            outHit[i] = outHit[i] == TerrainSampler::eSampleHit ? 1 : 0;
+        }
+        if (pending.empty()) {
+            return;
+        }
+
+        // where the terrains alone can't tell, the first static surface from above, in batches
+        physx::PxQueryFilterData filterData(physx::PxQueryFlag::eSTATIC);
+        std::lock_guard<std::mutex> lock(mGroundMutex);
+        for (size_t first = 0; first < pending.size(); first += GROUND_BATCH_SIZE) {
+            size_t batch = std::min(pending.size() - first, size_t(GROUND_BATCH_SIZE));
+            for (size_t k = 0; k < batch; k++) {
+                unsigned i = pending[first + k];
+                physx::PxVec3 origin(xz[i * 2], GROUND_RAY_HEIGHT, xz[i * 2 + 1]);
+                mGroundQuery->raycast(origin, physx::PxVec3(0.0f, -1.0f, 0.0f), 2.0f * GROUND_RAY_HEIGHT, 0, physx::PxHitFlag::eDEFAULT, filterData);
+            }
+            mGroundQuery->execute();
+            for (size_t k = 0; k < batch; k++) {
+                unsigned i = pending[first + k];
+                auto &result = mGroundResults[k];
+                heights[i] = result.hasBlock ? result.block.position.y : 0.0f;
+                outHit[i] = result.hasBlock ? 1 : 0;
+            }
+        }
+    }
+
+    void PhysxSceneImpl::addHeightField(physx::PxRigidActor* actor) {
+        if (actor == nullptr) {
+            return;
+        }
+        SCENE_LOCK();
+        mHeightFields.push_back(actor);
+        mTerrainDirty = true;
+    }
+
+    // rebuilds the copy of the runtime heightfields when one was added, removed or moved
+    void PhysxSceneImpl::refreshTerrainSampler() {
+        for (size_t i = 0; i < mHeightFields.size() && !mTerrainDirty; i++) {
+            mTerrainDirty = !(mHeightFields[i]->getGlobalPose() == mHeightFieldPoses[i]);
+        }
+        if (!mTerrainDirty) {
+            return;
+        }
+        mTerrainSampler.Clear();
+        mHeightFieldPoses.resize(mHeightFields.size());
+        for (size_t i = 0; i < mHeightFields.size(); i++) {
+            mHeightFieldPoses[i] = mHeightFields[i]->getGlobalPose();
+            physx::PxShape* shape = nullptr;
+            physx::PxHeightFieldGeometry geom;
+            if (mHeightFields[i]->getShapes(&shape, 1) == 1 && shape->getHeightFieldGeometry(geom)) {
+                mTerrainSampler.AddTerrain(geom, mHeightFieldPoses[i] * shape->getLocalPose());
+            }
+        }
+        mTerrainDirty = false;
+    }
+
+    void PhysxSceneImpl::updateInterest() {
+        physx::PxU32 count = 0;
+        const physx::PxActiveTransform* transforms = mScene->getActiveTransforms(count);
+        for (physx::PxU32 i = 0; i < count; i++) {
+            mInterest.Update((uint64_t)transforms[i].actor, transforms[i].actor2World.p.x, transforms[i].actor2World.p.z);
+        }
+    }
+
+    void PhysxSceneImpl::Snapshot(std::vector<uint8_t> &buffer) {
+        SCENE_READ_LOCK();
+        uint32_t count = 0;
+        for (auto it = mPhysicsActors.begin(); it != mPhysicsActors.end(); ++it) {
+            if (it->first->getType() == physx::PxActorType::eRIGID_DYNAMIC) {
+                count++;
+            }
+        }
+        buffer.resize(sizeof(SnapshotHeader) + count * sizeof(ActorState));
+        auto header = (SnapshotHeader*)buffer.data();
+        header->Magic = SNAPSHOT_MAGIC;
+        header->Count = count;
+        auto state = (ActorState*)(buffer.data() + sizeof(SnapshotHeader));
+        for (auto it = mPhysicsActors.begin(); it != mPhysicsActors.end(); ++it) {
+            if (it->first->getType() != physx::PxActorType::eRIGID_DYNAMIC) {
+                continue;
+            }
+            auto actor = (physx::PxRigidDynamic*)it->first;
+            state->Id = (uint64_t)actor;
+            state->Pose = actor->getGlobalPose();
+            state->Flags = 0;
+            if (actor->getRigidBodyFlags() & physx::PxRigidBodyFlag::eKINEMATIC) {
+                state->Flags |= ActorState::eKinematic;
+                state->LinearVelocity = physx::PxVec3(0.0f);
+                state->AngularVelocity = physx::PxVec3(0.0f);
+                if (actor->getKinematicTarget(state->Target)) {
+                    state->Flags |= ActorState::eHasTarget;
+                }
+                else {
+                    state->Target = state->Pose;
+                }
+            }
+            else {
+                state->LinearVelocity = actor->getLinearVelocity();
+                state->AngularVelocity = actor->getAngularVelocity();
+                state->Target = state->Pose;
+            }
+            if (actor->isSleeping()) {
+                state->Flags |= ActorState::eSleeping;
+            }
+            state++;
+        }
+    }
+
+    bool PhysxSceneImpl::Restore(const std::vector<uint8_t> &buffer) {
+        if (buffer.size() < sizeof(SnapshotHeader)) {
+            ERROR("[physx] restore snapshot fail. buffer too small");
+            return false;
+        }
+        auto header = (const SnapshotHeader*)buffer.data();
+        if (header->Magic != SNAPSHOT_MAGIC || buffer.size() != sizeof(SnapshotHeader) + header->Count * sizeof(ActorState)) {
+            ERROR("[physx] restore snapshot fail. bad header");
+            return false;
+        }
+        SCENE_LOCK();
+        auto state = (const ActorState*)(buffer.data() + sizeof(SnapshotHeader));
+        for (uint32_t i = 0; i < header->Count; i++, state++) {
+            auto actor = (physx::PxRigidActor*)state->Id;
+            if (mPhysicsActors.find(actor) == mPhysicsActors.end() || actor->getType() != physx::PxActorType::eRIGID_DYNAMIC) {
+                // removed since the snapshot was taken
+                continue;
+            }
+            auto dynamicActor = (physx::PxRigidDynamic*)actor;
+            dynamicActor->setGlobalPose(state->Pose, false);
+            if (mInterest.Enabled()) {
+                mInterest.Update(state->Id, state->Pose.p.x, state->Pose.p.z);
+            }
+            if (mPhysicsActors[actor] == eControllerActor) {
+                mControllers[actor]->setPosition(physx::PxExtendedVec3(state->Pose.p.x, state->Pose.p.y, state->Pose.p.z));
+            }
+            if (state->Flags & ActorState::eKinematic) {
+                if (state->Flags & ActorState::eHasTarget) {
+                    dynamicActor->setKinematicTarget(state->Target);
+                }
+                continue;
+            }
+            dynamicActor->clearForce();
+            dynamicActor->clearTorque();
+            if (state->Flags & ActorState::eSleeping) {
+                dynamicActor->putToSleep();
+            }
+            else {
+                dynamicActor->setLinearVelocity(state->LinearVelocity);
+                dynamicActor->setAngularVelocity(state->AngularVelocity);
+            }
+        }
+        mInterpolation.clear();
+        return true;
+    }
+
+    bool PhysxSceneImpl::Clone(PhysxSceneImpl &dst, const std::vector<uint8_t> &snapshot, std::unordered_map<uint64_t, uint64_t> &idMap) {
+        dst.mAngularDamping = mAngularDamping;
+        if (!dst.Init(mConfig)) {
+            return false;
+        }
+        // same palette, same indices
+        std::unordered_map<physx::PxMaterial*, physx::PxMaterial*> materialMap;
+        for (size_t i = 0; i < mMaterials.size(); i++) {
+            auto src = mMaterials[i];
+            physx::PxMaterial* material = dst.mMaterials[0];
+            if (i == 0) {
+                material->setStaticFriction(src->getStaticFriction());
+                material->setDynamicFriction(src->getDynamicFriction());
+                material->setRestitution(src->getRestitution());
+                dst.mMaterialIndex.clear();
+                dst.mMaterialIndex[std::make_tuple(src->getStaticFriction(), src->getDynamicFriction(), src->getRestitution())] = 0;
+            }
+            else {
+                unsigned index = dst.CreateMaterial(src->getStaticFriction(), src->getDynamicFriction(), src->getRestitution());
+                material = dst.getMaterial(index);
+            }
+            materialMap[src] = material;
+            if (src == mMaterial) {
+                dst.mMaterial = material;
+            }
+        }
+        dst.SetFixedTimestep(mFixedStep, mMaxSubSteps);
+        if (mScenePath != "" && !dst.CreateScene(mScenePath)) {
+            return false;
+        }
+
+        SCENE_READ_LOCK();
+        SceneWriteLock dstLock(dst.mLocking ? dst.mScene : nullptr);
+        std::vector<physx::PxShape*> shapes;
+        std::vector<physx::PxMaterial*> materials;
+        for (auto it = mPhysicsActors.begin(); it != mPhysicsActors.end(); ++it) {
+            if (it->second != eRuntimeActor) {
+                continue;
+            }
+            auto src = it->first;
+            physx::PxRigidActor* actor = nullptr;
+            if (src->getType() == physx::PxActorType::eRIGID_DYNAMIC) {
+                auto srcDynamic = (physx::PxRigidDynamic*)src;
+                auto dynamicActor = gPhysxSDKImpl->GetPhysics()->createRigidDynamic(src->getGlobalPose());
+                if (dynamicActor) {
+                    // kinematic and CCD flags, solver iterations and sleep threshold as configured at creation
+                    physx::PxU32 positionIterations, velocityIterations;
+                    srcDynamic->getSolverIterationCounts(positionIterations, velocityIterations);
+                    dynamicActor->setRigidBodyFlags(srcDynamic->getRigidBodyFlags());
+                    dynamicActor->setSolverIterationCounts(positionIterations, velocityIterations);
+                    dynamicActor->setSleepThreshold(srcDynamic->getSleepThreshold());
+                    dynamicActor->setStabilizationThreshold(srcDynamic->getStabilizationThreshold());
+                    dynamicActor->setMaxAngularVelocity(srcDynamic->getMaxAngularVelocity());
+                    dynamicActor->setMass(srcDynamic->getMass());
+                    dynamicActor->setMassSpaceInertiaTensor(srcDynamic->getMassSpaceInertiaTensor());
+                    dynamicActor->setCMassLocalPose(srcDynamic->getCMassLocalPose());
+                    dynamicActor->setAngularDamping(srcDynamic->getAngularDamping());
+                    dynamicActor->setLinearDamping(srcDynamic->getLinearDamping());
+                }
+                actor = dynamicActor;
+            }
+            else {
+                actor = gPhysxSDKImpl->GetPhysics()->createRigidStatic(src->getGlobalPose());
+            }
+            if (!actor) {
+                ERROR("[physx] clone actor failed!");
+                continue;
+            }
+            shapes.resize(src->getNbShapes());
+            physx::PxU32 shapeCount = src->getShapes(shapes.data(), physx::PxU32(shapes.size()));
+            for (physx::PxU32 i = 0; i < shapeCount; i++) {
+                materials.resize(shapes[i]->getNbMaterials());
+                physx::PxU32 materialCount = shapes[i]->getMaterials(materials.data(), physx::PxU32(materials.size()));
+                for (physx::PxU32 j = 0; j < materialCount; j++) {
+                    auto found = materialMap.find(materials[j]);
+                    if (found != materialMap.end()) {
+                        materials[j] = found->second;
+                    }
+                }
+                auto shape = physx::PxRigidActorExt::createExclusiveShape(*actor, shapes[i]->getGeometry().any(), materials.data(), physx::PxU16(materialCount), shapes[i]->getFlags());
+                if (shape) {
+                    shape->setLocalPose(shapes[i]->getLocalPose());
+                    shape->setSimulationFilterData(shapes[i]->getSimulationFilterData());
+                }
+            }
+            actor->setActorFlag(physx::PxActorFlag::eVISUALIZATION, src->getActorFlags() & physx::PxActorFlag::eVISUALIZATION);
+            dst.mScene->addActor(*actor);
+            dst.addPhysicsActor(actor, eRuntimeActor);
+            if (std::find(mHeightFields.begin(), mHeightFields.end(), src) != mHeightFields.end()) {
+                dst.mHeightFields.push_back(actor);
+                dst.mTerrainDirty = true;
+            }
+            idMap[(uint64_t)src] = (uint64_t)actor;
+        }
+
+        std::vector<uint8_t> remapped(snapshot);
+        if (remapped.size() >= sizeof(SnapshotHeader)) {
+            auto header = (SnapshotHeader*)remapped.data();
+            auto state = (ActorState*)(remapped.data() + sizeof(SnapshotHeader));
+            for (uint32_t i = 0; i < header->Count && (uint8_t*)(state + 1) <= remapped.data() + remapped.size(); i++, state++) {
+                auto found = idMap.find(state->Id);
+                state->Id = found != idMap.end() ? found->second : 0;
+            }
+        }
+        return dst.Restore(remapped);
+    }
 }
\ No newline at end of file
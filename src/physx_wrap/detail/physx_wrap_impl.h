@@ -7,38 +7,78 @@
 #include <cooking/PxCooking.h>
 #include <PxScene.h>
 #include <PxRigidActor.h>
+#include <PxAggregate.h>
+#include <PxBatchQuery.h>
+#include <PxBatchQueryDesc.h>
+#include <characterkinematic/PxControllerManager.h>
 #include <atomic>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <tuple>
+#include <mutex>
 #include "physx_pvd.h"
+#include "pose_history.h"
+#include "interest_grid.h"
+#include "transform_codec.h"
+#include "simulation_events.h"
+#include "command_log.h"
+#include "terrain_sampler.h"
 #include "../PhysxWrap.h"
 
 namespace PhysxWrap {
 
+    class SceneInfo;
+
     class PhysxSceneImpl
     {
     public:
         PhysxSceneImpl();
         ~PhysxSceneImpl();
 
-        bool Init();
+        bool Init(const SceneConfig &config);
         bool CreateScene(const std::string &path);
         void Update(float elapsedTime);
+        void FlushQueryUpdates();
+        void SetFixedTimestep(float step, unsigned maxSubSteps);
+        float GetInterpolationAlpha();
+        physx::PxTransform GetInterpolatedPose(physx::PxRigidActor* actor);
         physx::PxRigidActor* CreatePlane(float xNormal, float yNormal, float zNormal, float distance);
         physx::PxRigidActor* CreateHeightField(const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale);
+        physx::PxRigidActor* CreateHeightField(const std::vector<int16_t> &heightmap, unsigned columns, unsigned rows, const Vector3 &scale, const std::vector<uint8_t> &cellMaterials, const std::vector<Material> &materials);
         physx::PxRigidActor* CreateHeightField(const physx::PxHeightFieldGeometry &hfGeom);
-        physx::PxRigidActor* CreateBoxDynamic(const Vector3 &pos, const Vector3 &halfExtents, float density);
-        physx::PxRigidActor* CreateBoxKinematic(const Vector3 &pos, const Vector3 &halfExtents, float density);
-        physx::PxRigidActor* CreateBoxStatic(const Vector3 &pos, const Vector3 &halfExtents);
-        physx::PxRigidActor* CreateSphereDynamic(const Vector3 &pos, float radius, float density);
-        physx::PxRigidActor* CreateSphereKinematic(const Vector3 &pos, float radius, float density);
-        physx::PxRigidActor* CreateSphereStatic(const Vector3 &pos, float radius);
-        physx::PxRigidActor* CreateCapsuleDynamic(const Vector3 &pos, float radius, float halfHeight, float density);
-        physx::PxRigidActor* CreateCapsuleKinematic(const Vector3 &pos, float radius, float halfHeight, float density);
-        physx::PxRigidActor* CreateCapsuleStatic(const Vector3 &pos, float radius, float halfHeight);
-        physx::PxRigidActor* CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, float density);
-        physx::PxRigidActor* CreateMeshKinematic(const Vector3 &pos, const physx::PxTriangleMeshGeometry &triGeom, float density);
-        physx::PxRigidActor* CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib);
-        physx::PxRigidActor* CreateMeshStatic(const Vector3 &pos, const physx::PxTriangleMeshGeometry &triGeom);
+        // materials: the shape's material table indexed by the heightfield samples; empty uses the current material
+        physx::PxRigidActor* CreateHeightField(const physx::PxHeightFieldGeometry &hfGeom, const std::vector<physx::PxMaterial*> &materials);
+        physx::PxRigidActor* CreateBoxDynamic(const Vector3 &pos, const Vector3 &halfExtents, const BodyDesc &body);
+        physx::PxRigidActor* CreateBoxKinematic(const Vector3 &pos, const Vector3 &halfExtents, const BodyDesc &body);
+        physx::PxRigidActor* CreateBoxStatic(const Vector3 &pos, const Vector3 &halfExtents, unsigned material = eCurrentMaterial);
+        physx::PxRigidActor* CreateSphereDynamic(const Vector3 &pos, float radius, const BodyDesc &body);
+        physx::PxRigidActor* CreateSphereKinematic(const Vector3 &pos, float radius, const BodyDesc &body);
+        physx::PxRigidActor* CreateSphereStatic(const Vector3 &pos, float radius, unsigned material = eCurrentMaterial);
+        physx::PxRigidActor* CreateCapsuleDynamic(const Vector3 &pos, float radius, float halfHeight, const BodyDesc &body);
+        physx::PxRigidActor* CreateCapsuleKinematic(const Vector3 &pos, float radius, float halfHeight, const BodyDesc &body);
+        physx::PxRigidActor* CreateCapsuleStatic(const Vector3 &pos, float radius, float halfHeight, unsigned material = eCurrentMaterial);
+        physx::PxRigidActor* CreateConvexDynamic(const Vector3 &pos, const std::vector<float> &points, unsigned vertexLimit, const BodyDesc &body);
+        physx::PxRigidActor* CreateConvexKinematic(const Vector3 &pos, const std::vector<float> &points, unsigned vertexLimit, const BodyDesc &body);
+        physx::PxRigidActor* CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, const BodyDesc &body);
+        physx::PxRigidActor* CreateMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib, const BodyDesc &body);
+        physx::PxRigidActor* CreateMeshKinematic(const Vector3 &pos, const physx::PxTriangleMeshGeometry &triGeom, const BodyDesc &body);
+        physx::PxRigidActor* CreateMeshKinematic(uint64_t meshId, const Vector3 &pos, const Quat &rotate, const Vector3 &scale, const BodyDesc &body);
+        physx::PxRigidActor* CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint16_t> &ib, unsigned material = eCurrentMaterial);
+        physx::PxRigidActor* CreateMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<uint32_t> &ib, unsigned material = eCurrentMaterial);
+        physx::PxRigidActor* CreateMeshStatic(const Vector3 &pos, const physx::PxTriangleMeshGeometry &triGeom, unsigned material = eCurrentMaterial);
+        physx::PxRigidActor* CreateMeshStatic(uint64_t meshId, const Vector3 &pos, const Quat &rotate, const Vector3 &scale, unsigned material = eCurrentMaterial);
+
+        physx::PxRigidActor* CreateCompoundDynamic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body);
+        physx::PxRigidActor* CreateCompoundKinematic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body);
+        physx::PxRigidActor* CreateCompoundStatic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes);
+        physx::PxAggregate* CreateAggregate(unsigned maxActors, bool selfCollision);
+        bool AddToAggregate(physx::PxAggregate* aggregate, physx::PxRigidActor* actor);
+        void RemoveAggregate(physx::PxAggregate* aggregate);
+
+        physx::PxRigidActor* CreateCapsuleController(const Vector3 &pos, float radius, float halfHeight, float stepOffset, float slopeLimit);
+        void MoveControllers(const uint64_t *ids, const Vector3 *displacements, unsigned count, float elapsedTime, uint8_t *outFlags);
 
         void RemoveActor(physx::PxRigidActor* actor);
 
@@ -54,22 +94,134 @@ namespace PhysxWrap {
         bool IsStaticObj(physx::PxRigidActor* actor);
         bool IsDynamicObj(physx::PxRigidActor* actor);
 
+        bool SetTrigger(physx::PxRigidActor* actor, bool trigger);
+        void EnableContactEvents(physx::PxRigidActor* actor, bool enable);
+        void SetEventCapacity(unsigned capacity);
+        unsigned DrainEvents(PhysicsEvent *buffer, unsigned capacity);
+        unsigned GetDroppedEvents();
+
+        unsigned CreateMaterial(float staticFriction, float dynamicFriction, float restitution);
+        void SetCurrentMaterial(unsigned index);
         void SetCurrentMaterial(float staticFriction, float dynamicFriction, float restitution);
         void SetCurrentAngularDamping(float value);
 
+        bool Raycast(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit);
+        bool RaycastDynamic(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit);
+        void EnableHistory(unsigned frames);
+        float GetSimulationTime();
+        bool RaycastAt(float time, const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit);
+
+        void CaptureTransforms(std::vector<uint8_t> &state, unsigned positionBits);
+
+        void EnableInterest(float cellSize);
+        void QueryInterest(const Vector3 *observers, unsigned count, float radius, std::vector<uint64_t> &ids, std::vector<unsigned> &offsets);
+
+        // nothing set since Init: no actors, scene file, fixed step, materials, angular damping, history or interest
+        bool IsInitState();
+
+        void SampleTerrainHeights(const float *xz, unsigned count, float *heights, uint8_t *outHit);
+
+        void Snapshot(std::vector<uint8_t> &buffer);
+        bool Restore(const std::vector<uint8_t> &buffer);
+        bool Clone(PhysxSceneImpl &dst, const std::vector<uint8_t> &snapshot, std::unordered_map<uint64_t, uint64_t> &idMap);
+
     protected:
         virtual void customizeTolerances(physx::PxTolerancesScale&) {}
-        virtual void customizeSceneDesc(physx::PxSceneDesc& desc) {}
 
     private:
         void release();
+        void simulate(float dtime);
+        void updateInterest();
+        void updateQueries(float dtime);
+        void addHeightField(physx::PxRigidActor* actor);
+        void refreshTerrainSampler();
+        void recordInterpolation();
+        float interpolationAlpha();     // caller holds the scene lock
+        physx::PxBounds3 captureBounds();
+        void markSceneInfoActor(physx::PxRigidActor* actor);
+        void addPhysicsActor(physx::PxRigidActor* actor, int type);
+        void addBroadPhaseRegions(const physx::PxBounds3 &bounds);
+        physx::PxMaterial* getMaterial(unsigned index);
+        // density handed to PxCreateDynamic/PxCreateKinematic: a placeholder when applyMass sets the mass
+        float creationDensity(const BodyDesc &body);
+        void applyMass(physx::PxRigidDynamic* actor, const BodyDesc &body);
+        physx::PxRigidActor* createCompoundDynamic(const Vector3 &pos, const Quat &rotate, const std::vector<ShapeDesc> &shapes, const BodyDesc &body, bool kinematic);
+        bool attachShapes(physx::PxRigidActor* actor, const std::vector<ShapeDesc> &shapes, unsigned material);
+        template<typename T>
+        physx::PxRigidActor* createMeshKinematic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<T> &ib, const BodyDesc &body);
+        template<typename T>
+        physx::PxRigidActor* createMeshStatic(const Vector3 &pos, const Vector3 &scale, const std::vector<float> &vb, const std::vector<T> &ib, unsigned material);
+
+        enum {
+            eRuntimeActor = 1,
+            eSceneInfoActor = 2,
+            eControllerActor = 3,   // owned by its controller in mControllers
+        };
+
+        struct SnapshotHeader {
+            uint32_t Magic;
+            uint32_t Count;
+        };
+
+        struct ActorState {
+            enum {
+                eKinematic = 1,
+                eHasTarget = 2,
+                eSleeping = 4,
+            };
+            uint64_t Id;
+            physx::PxTransform Pose;
+            physx::PxTransform Target;
+            physx::PxVec3 LinearVelocity;
+            physx::PxVec3 AngularVelocity;
+            uint32_t Flags;
+        };
 
+        struct InterpolationState {
+            physx::PxTransform Prev;
+            physx::PxTransform Curr;
+            unsigned Step;
+        };
+
+        SceneConfig mConfig;
         physx::PxScene* mScene;
+        bool mLocking;                                  // SCENE_LOCK/SCENE_READ_LOCK are active
         physx::PxDefaultCpuDispatcher* mCpuDispatcher;
-        physx::PxMaterial* mMaterial;
+        physx::PxMaterial* mMaterial;                   // current entry of mMaterials
+        std::vector<physx::PxMaterial*> mMaterials;     // palette, index 0 is the initial material
+        std::map<std::tuple<float, float, float>, unsigned> mMaterialIndex;   // friction/restitution -> first palette index
         void* mScratchBlock;
         float mAngularDamping;
         std::unordered_map<physx::PxRigidActor*, int> mPhysicsActors;
+        std::string mScenePath;
+        std::shared_ptr<SceneInfo> mSceneInfo;
+        physx::PxControllerManager* mControllerManager; // created by the first controller
+        std::unordered_map<physx::PxRigidActor*, physx::PxController*> mControllers;
+        std::unordered_set<physx::PxAggregate*> mAggregates;
+
+        float mFixedStep;
+        unsigned mMaxSubSteps;
+        float mAccumulator;
+        unsigned mStepCount;
+        std::unordered_map<physx::PxRigidActor*, InterpolationState> mInterpolation;
+
+        float mSimTime;
+        unsigned mQueryUpdates;                         // QueryOnly Updates since the last dynamic tree rebuild
+        physx::PxBounds3 mCaptureBounds;                // quantization range, fixed by the first CaptureTransforms
+        std::mutex mCaptureMutex;                       // guards mCaptureBounds
+        PoseHistory mHistory;
+        InterestGrid mInterest;
+        SimulationEvents mEvents;
+        std::unique_ptr<CommandRecorder> mRecorder;     // set by StartRecording
+
+        std::vector<physx::PxRigidActor*> mHeightFields;    // created by CreateHeightField; the scene file's are in its StaticWorld
+        std::vector<physx::PxTransform> mHeightFieldPoses;  // as of the last mTerrainSampler build
+        TerrainSampler mTerrainSampler;
+        bool mTerrainDirty;
+        std::mutex mTerrainMutex;                       // concurrent samplers under the read lock rebuild mTerrainSampler once
+        physx::PxBatchQuery* mGroundQuery;              // SampleTerrainHeights raycasts, GROUND_BATCH_SIZE per execute
+        std::vector<physx::PxRaycastQueryResult> mGroundResults;
+        std::mutex mGroundMutex;                        // one sampler at a time drives mGroundQuery
 
         friend class PhysxScene;
     };
@@ -0,0 +1,142 @@
+#include "pose_history.h"
+#include <PxRigidDynamic.h>
+#include <PxShape.h>
+#include <geometry/PxGeometryQuery.h>
+#include <algorithm>
+
+namespace PhysxWrap {
+
+    PoseHistory::PoseHistory()
+        : mCapacity(0)
+        , mHead(0)
+        , mCount(0)
+    {
+
+    }
+
+    void PoseHistory::Reset(unsigned frames) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFrames.clear();
+        mFrames.resize(frames);
+        mCapacity = frames;
+        mHead = 0;
+        mCount = 0;
+    }
+
+    bool PoseHistory::Enabled() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCapacity > 0;
+    }
+
+    void PoseHistory::Record(float time, const std::unordered_map<physx::PxRigidActor*, int> &actors) {
+        unsigned slot;
+        std::shared_ptr<Frame> frame;
+        {
+            // take the oldest frame out of the ring so no new reader can pick it up while it is rewritten
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mCapacity == 0) {
+                return;
+            }
+            slot = mHead;
+            frame = std::move(mFrames[slot]);
+            if (mCount == mCapacity) {
+                mCount--;
+            }
+        }
+        if (!frame || frame.use_count() != 1) {
+            frame = std::make_shared<Frame>();
+        }
+        frame->Time = time;
+        frame->Proxies.clear();
+
+        std::vector<physx::PxShape*> shapes;
+        for (auto it = actors.begin(); it != actors.end(); ++it) {
+            auto actor = it->first;
+            if (actor->getType() != physx::PxActorType::eRIGID_DYNAMIC) {
+                continue;
+            }
+            auto pose = actor->getGlobalPose();
+            shapes.resize(actor->getNbShapes());
+            physx::PxU32 count = actor->getShapes(shapes.data(), physx::PxU32(shapes.size()));
+            for (physx::PxU32 i = 0; i < count; i++) {
+                auto type = shapes[i]->getGeometryType();
+                if (type != physx::PxGeometryType::eSPHERE && type != physx::PxGeometryType::eCAPSULE && type != physx::PxGeometryType::eBOX) {
+                    // meshes may be released with their actor, only self-contained primitives are kept
+                    continue;
+                }
+                frame->Proxies.push_back(Proxy{ (uint64_t)actor, uint32_t(i), shapes[i]->getGeometry(), pose * shapes[i]->getLocalPose() });
+            }
+        }
+        // the actor map's iteration order changes whenever it rehashes
+        std::sort(frame->Proxies.begin(), frame->Proxies.end(), [](const Proxy &a, const Proxy &b) {
+            return a.Id != b.Id ? a.Id < b.Id : a.Shape < b.Shape;
+        });
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCapacity == 0 || slot >= mFrames.size()) {
+            return;
+        }
+        mFrames[slot] = frame;
+        mHead = (slot + 1) % mCapacity;
+        mCount++;
+    }
+
+    bool PoseHistory::Raycast(float time, const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) {
+        std::shared_ptr<Frame> from, to;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (unsigned i = 0; i < mCount; i++) {
+                // newest to oldest
+                auto &frame = mFrames[(mHead + mCapacity - 1 - i) % mCapacity];
+                to = from;
+                from = frame;
+                if (frame->Time <= time) {
+                    break;
+                }
+            }
+        }
+        if (!from) {
+            return false;
+        }
+        float alpha = 0.0f;
+        if (to && to->Time > from->Time && time > from->Time) {
+            alpha = (time - from->Time) / (to->Time - from->Time);
+        }
+        else {
+            to = nullptr;
+        }
+
+        physx::PxVec3 rayOrigin(origin.X, origin.Y, origin.Z);
+        physx::PxVec3 rayDir(unitDir.X, unitDir.Y, unitDir.Z);
+        bool found = false;
+        hit.Distance = distance;
+        auto &proxies = from->Proxies;
+        size_t j = 0;
+        for (size_t i = 0; i < proxies.size(); i++) {
+            auto pose = proxies[i].Pose;
+            if (to) {
+                // both lists are sorted: advance to this proxy's counterpart, if the actor still existed then
+                auto &next = to->Proxies;
+                while (j < next.size() && (next[j].Id < proxies[i].Id || (next[j].Id == proxies[i].Id && next[j].Shape < proxies[i].Shape))) {
+                    j++;
+                }
+            }
+            if (to && j < to->Proxies.size() && to->Proxies[j].Id == proxies[i].Id && to->Proxies[j].Shape == proxies[i].Shape) {
+                auto &next = to->Proxies[j].Pose;
+                pose.p = pose.p + (next.p - pose.p) * alpha;
+                physx::PxQuat q = pose.q.dot(next.q) < 0.0f ? -next.q : next.q;
+                pose.q = (pose.q * (1.0f - alpha) + q * alpha).getNormalized();
+            }
+            physx::PxRaycastHit rayHit;
+            if (physx::PxGeometryQuery::raycast(rayOrigin, rayDir, proxies[i].Geom.any(), pose, hit.Distance, physx::PxHitFlag::eDEFAULT, 1, &rayHit) > 0) {
+                found = true;
+                hit.Id = proxies[i].Id;
+                hit.Postion = Vector3{ rayHit.position.x, rayHit.position.y, rayHit.position.z };
+                hit.Normal = Vector3{ rayHit.normal.x, rayHit.normal.y, rayHit.normal.z };
+                hit.Distance = rayHit.distance;
+            }
+        }
+        return found;
+    }
+
+}
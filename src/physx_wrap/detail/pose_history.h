@@ -0,0 +1,50 @@
+#ifndef __POSE_HISTORY_H__
+#define __POSE_HISTORY_H__
+
+#include <PxRigidActor.h>
+#include <geometry/PxGeometryHelpers.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include "../PhysxWrap.h"
+
+namespace PhysxWrap {
+
+    // ring buffer of primitive proxies (sphere/capsule/box) of moving actors, one frame per simulation step.
+    // Record runs on the simulating thread; Raycast may run on any thread concurrently with simulate.
+    class PoseHistory
+    {
+    public:
+        PoseHistory();
+
+        void Reset(unsigned frames);
+        bool Enabled() const;
+
+        void Record(float time, const std::unordered_map<physx::PxRigidActor*, int> &actors);
+        bool Raycast(float time, const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit);
+
+    private:
+        // frames keep their proxies sorted by (Id, Shape) so two frames pair up by merging
+        struct Proxy {
+            uint64_t Id;
+            uint32_t Shape;     // index among the actor's shapes
+            physx::PxGeometryHolder Geom;
+            physx::PxTransform Pose;
+        };
+
+        struct Frame {
+            float Time;
+            std::vector<Proxy> Proxies;
+        };
+
+        mutable std::mutex mMutex;                  // guards the ring: mFrames, mCapacity, mHead, mCount
+        std::vector<std::shared_ptr<Frame>> mFrames;
+        unsigned mCapacity;
+        unsigned mHead;     // next slot to write
+        unsigned mCount;
+    };
+
+};
+
+#endif
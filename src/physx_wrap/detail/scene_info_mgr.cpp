@@ -1,18 +1,41 @@
 #include "scene_info_mgr.h"
 #include "physx_sdk.h"
+#include "mesh_registry.h"
 #include "util.h"
 #include "log.h"
 #include <cassert>
+#include <cstring>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <foundation/PxQuat.h>
 
 namespace PhysxWrap {
 
-    SceneInfo::SceneInfo() {
+    SceneInfo::SceneInfo()
+        : mBytes(0)
+        , mLastAccess(0)
+    {
 
     }
 
     SceneInfo::~SceneInfo() {
-
+        for (size_t i = 0; i < mMeshIds.size(); i++)
+        {
+            gMeshRegistry->Unregister(mMeshIds[i]);
+        }
+        if (gPhysxSDKImpl->IsInit())
+        {
+            for (size_t i = 0; i < Terrains.size(); i++)
+            {
+                Terrains[i].Geom.heightField->release();
+            }
+            for (size_t i = 0; i < mMaterials.size(); i++)
+            {
+                mMaterials[i]->release();
+            }
+        }
     }
 
     bool SceneInfo::Load(const std::string path) {
@@ -61,7 +84,12 @@ namespace PhysxWrap {
             break;
             case eTerrainObj:
             {
-                parseTerrain(pcontent);
+                parseTerrain(pcontent, false);
+            }
+            break;
+            case eTerrainObj2:
+            {
+                parseTerrain(pcontent, true);
             }
             break;
             case eSphereObj:
@@ -72,43 +100,65 @@ namespace PhysxWrap {
             default:
                 assert(false);
                 ERROR("load scene fail #2. path = %s", path.c_str());
+                mMeshDatas.clear();
                 return false;
             }
         }
+        mMeshDatas.clear();
+        mStaticWorld.Build(*this);
+        mBytes = computeBytes();
         auto t2 = GetTimeStamp();
-        INFO("load scene done. cost time = %u ms", unsigned(t2 - t1));
+        INFO("load scene done. cost time = %u ms, bytes = %llu", unsigned(t2 - t1), (unsigned long long)mBytes);
         return true;
     }
 
+    uint64_t SceneInfo::computeBytes() {
+        uint64_t bytes = sizeof(SceneInfo);
+        for (size_t i = 0; i < mMeshIds.size(); i++)
+        {
+            bytes += gMeshRegistry->GetCookedBytes(mMeshIds[i]);
+        }
+        for (size_t i = 0; i < Terrains.size(); i++)
+        {
+            auto hf = Terrains[i].Geom.heightField;
+            bytes += uint64_t(hf->getNbRows()) * hf->getNbColumns() * sizeof(physx::PxHeightFieldSample);
+            bytes += Terrains[i].Materials.capacity() * sizeof(physx::PxMaterial*);
+        }
+        bytes += Meshs.capacity() * sizeof(MeshInfo);
+        bytes += Boxs.capacity() * sizeof(BoxInfo);
+        bytes += Capsules.capacity() * sizeof(CapsuleInfo);
+        bytes += Terrains.capacity() * sizeof(TerrainInfo);
+        bytes += Spheres.capacity() * sizeof(SphereInfo);
+        bytes += mStaticWorld.GetBytes();
+        return bytes;
+    }
+
     void SceneInfo::parseMesh1(char* &pcontent) {
-        MeshInfo info;
+        MeshData data;
+        data.MeshId = 0;
         uint16_t type = *(uint16_t*)pcontent;
         pcontent += sizeof(uint16_t);
-        assert(type == eMeshData);
+        assert(type == eMeshData || type == eMeshData32);
         uint32_t vlen = *(uint32_t*)pcontent;
         pcontent += sizeof(uint32_t);
-        for (size_t i = 0; i < vlen; i++)
-        {
-            float x = *(float*)pcontent;
-            pcontent += sizeof(float);
-            float y = *(float*)pcontent;
-            pcontent += sizeof(float);
-            float z = *(float*)pcontent;
-            pcontent += sizeof(float);
-            info.vb.push_back(x);
-            info.vb.push_back(y);
-            info.vb.push_back(z);
-        }
+        data.vb.resize(vlen * 3);
+        memcpy(data.vb.data(), pcontent, vlen * 3 * sizeof(float));
+        pcontent += vlen * 3 * sizeof(float);
         uint32_t ilen = *(uint32_t*)pcontent;
         pcontent += sizeof(uint32_t);
-        std::vector<uint16_t> ib;
-        for (size_t i = 0; i < ilen; i++)
+        if (type == eMeshData32)
         {
-            uint16_t v = *(uint16_t*)pcontent;
-            pcontent += sizeof(uint16_t);
-            info.ib.push_back(v);
+            data.ib32.resize(ilen);
+            memcpy(data.ib32.data(), pcontent, ilen * sizeof(uint32_t));
+            pcontent += ilen * sizeof(uint32_t);
         }
-        Meshs.emplace_back(info);
+        else
+        {
+            data.ib.resize(ilen);
+            memcpy(data.ib.data(), pcontent, ilen * sizeof(uint16_t));
+            pcontent += ilen * sizeof(uint16_t);
+        }
+        mMeshDatas.emplace_back(std::move(data));
     }
 
     void SceneInfo::parseBox(char* &pcontent) {
@@ -144,26 +194,105 @@ namespace PhysxWrap {
         pcontent += sizeof(float);
         uint32_t meshIndex = *(uint32_t*)pcontent;
         pcontent += sizeof(uint32_t);
-        assert(meshIndex < Meshs.size());
-        if (meshIndex < Meshs.size())
+        assert(meshIndex < mMeshDatas.size());
+        if (meshIndex < mMeshDatas.size())
         {
-            auto &info = Meshs[meshIndex];
+            auto &data = mMeshDatas[meshIndex];
+            if (data.MeshId == 0)
+            {
+                // cooked on first use and shared by every instance of the mesh
+                data.MeshId = data.ib32.empty() ? gMeshRegistry->Register(data.vb, data.ib) : gMeshRegistry->Register(data.vb, data.ib32);
+                if (data.MeshId == 0)
+                {
+                    assert(false);
+                    return;
+                }
+                mMeshIds.push_back(data.MeshId);
+                // the registry keeps the cooked mesh, the source data is not needed anymore
+                std::vector<float>().swap(data.vb);
+                std::vector<uint16_t>().swap(data.ib);
+                std::vector<uint32_t>().swap(data.ib32);
+            }
+            MeshInfo info;
             info.Postion = baseInfo.Postion;
             info.Rotate = baseInfo.Rotate;
             info.Layer = baseInfo.Layer;
-            info.scale = Vector3{ xScale,yScale,zScale };
-            if (GetMeshGeometry(info.Geom, info.Postion, info.scale, info.vb, info.ib) == false) {
-                assert(false);
+            info.MeshId = data.MeshId;
+            info.Scale = Vector3{ xScale,yScale,zScale };
+            info.Geom.triangleMesh = gMeshRegistry->Get(data.MeshId);
+            info.Geom.scale = physx::PxMeshScale(physx::PxVec3{ xScale, yScale, zScale }, physx::PxQuat(physx::PxIdentity));
+            Meshs.emplace_back(info);
+        }
+    }
+
+#define TERRAIN_BLOCK (16)
+#define TERRAIN_MIN_HEIGHT_SCALE (1e-6f)
+
+    // heights: d x d normalized samples, row-major by z (as exported from unity).
+    // Writes the tile [x0, x0 + rows) x [z0, z0 + columns) in physx order (row = x, column = z),
+    // quantized to the full int16 range; returns the world height of sample value 0.
+    static float quantizeTerrainTile(const std::vector<float> &heights, unsigned d, unsigned x0, unsigned z0, unsigned rows, unsigned columns, float sizeY, std::vector<int16_t> &out, float &heightScale) {
+        float minV = 1.0f;
+        float maxV = 0.0f;
+        for (unsigned z = z0; z < z0 + columns; z++)
+        {
+            const float *src = &heights[z * d + x0];
+            for (unsigned x = 0; x < rows; x++)
+            {
+                minV = std::min(minV, src[x]);
+                maxV = std::max(maxV, src[x]);
             }
         }
+        float base = minV * sizeY;
+        heightScale = std::max((maxV - minV) * sizeY / 65535.0f, TERRAIN_MIN_HEIGHT_SCALE);
+        float invScale = 1.0f / heightScale;
+
+        // blocked transpose, keeps both the source rows and the destination rows in cache
+        out.resize(rows * columns);
+        for (unsigned zb = 0; zb < columns; zb += TERRAIN_BLOCK)
+            for (unsigned xb = 0; xb < rows; xb += TERRAIN_BLOCK)
+            {
+                unsigned zEnd = std::min(zb + TERRAIN_BLOCK, columns);
+                unsigned xEnd = std::min(xb + TERRAIN_BLOCK, rows);
+                for (unsigned z = zb; z < zEnd; z++)
+                {
+                    const float *src = &heights[(z0 + z) * d + x0];
+                    for (unsigned x = xb; x < xEnd; x++)
+                    {
+                        float q = (src[x] * sizeY - base) * invScale - 32768.0f;
+                        q = std::min(std::max(q + 0.5f, -32768.0f), 32767.0f);
+                        out[x * columns + z] = int16_t(std::floor(q));
+                    }
+                }
+            }
+        return base + 32768.0f * heightScale;
     }
 
-    void SceneInfo::parseTerrain(char* &pcontent) {
-        TerrainInfo info;
-        parseObjBaseInfo(pcontent, &info);
+    // cells: (d - 1) x (d - 1) material indices, row-major by z; same tile layout as quantizeTerrainTile
+    static void transposeTerrainCells(const std::vector<uint8_t> &cells, unsigned d, unsigned x0, unsigned z0, unsigned rows, unsigned columns, std::vector<uint8_t> &out) {
+        unsigned stride = d - 1;
+        out.resize(rows * columns);
+        for (unsigned zb = 0; zb < columns; zb += TERRAIN_BLOCK)
+            for (unsigned xb = 0; xb < rows; xb += TERRAIN_BLOCK)
+            {
+                unsigned zEnd = std::min(zb + TERRAIN_BLOCK, columns);
+                unsigned xEnd = std::min(xb + TERRAIN_BLOCK, rows);
+                for (unsigned z = zb; z < zEnd; z++)
+                {
+                    const uint8_t *src = &cells[(z0 + z) * stride + x0];
+                    for (unsigned x = xb; x < xEnd; x++)
+                    {
+                        out[x * columns + z] = src[x];
+                    }
+                }
+            }
+    }
+
+    void SceneInfo::parseTerrain(char* &pcontent, bool withMaterials) {
+        ObjInfoBase baseInfo;
+        parseObjBaseInfo(pcontent, &baseInfo);
         Vector3 size;
         uint32_t d;
-        std::vector<int16_t> data;
         size.X = *(float*)pcontent;
         pcontent += sizeof(float);
         size.Y = *(float*)pcontent;
@@ -172,22 +301,100 @@ namespace PhysxWrap {
         pcontent += sizeof(float);
         d = *(uint32_t*)pcontent;
         pcontent += sizeof(uint32_t);
-        data.resize(d*d);
-        for (size_t i = 0; i < d; i++)
-            for (size_t j = 0; j < d; j++)
+        std::vector<float> heights(d * d);
+        memcpy(heights.data(), pcontent, d * d * sizeof(float));
+        pcontent += d * d * sizeof(float);
+
+        std::vector<physx::PxMaterial*> materials;
+        std::vector<uint8_t> cellMaterials;
+        if (withMaterials)
+        {
+            uint32_t materialCount = *(uint32_t*)pcontent;
+            pcontent += sizeof(uint32_t);
+            for (uint32_t i = 0; i < materialCount; i++)
             {
-                float v = *(float*)pcontent;
+                float staticFriction = *(float*)pcontent;
+                pcontent += sizeof(float);
+                float dynamicFriction = *(float*)pcontent;
                 pcontent += sizeof(float);
-                data[j*d + i] = int16_t(v*size.Y);
+                float restitution = *(float*)pcontent;
+                pcontent += sizeof(float);
+                auto material = gPhysxSDKImpl->GetPhysics()->createMaterial(staticFriction, dynamicFriction, restitution);
+                if (material)
+                {
+                    mMaterials.push_back(material);
+                    materials.push_back(material);
+                }
+            }
+            if (d > 0)
+            {
+                cellMaterials.resize((d - 1) * (d - 1));
+                memcpy(cellMaterials.data(), pcontent, cellMaterials.size());
+                pcontent += cellMaterials.size();
+            }
+            for (size_t i = 0; i < cellMaterials.size(); i++)
+            {
+                if (cellMaterials[i] >= materials.size() && cellMaterials[i] != eTerrainHole)
+                {
+                    cellMaterials[i] = 0;
+                }
+            }
+            if (materials.empty())
+            {
+                // holes still apply, index 0 falls back to the room's material
+                for (size_t i = 0; i < cellMaterials.size(); i++)
+                {
+                    if (cellMaterials[i] != eTerrainHole)
+                    {
+                        cellMaterials[i] = 0;
+                    }
+                }
             }
-
-        if (GetHeightFieldGeometry(info.Geom, data, d, d, Vector3{ size.X / (d - 1), 1, size.Z / (d - 1) })) {
-            Terrains.emplace_back(info);
         }
-        else
+        if (d < 2)
         {
             assert(false);
+            return;
+        }
+
+        float cellX = size.X / (d - 1);
+        float cellZ = size.Z / (d - 1);
+        unsigned cells = d - 1;
+        unsigned tileCells = gSceneInfoMgr->GetTerrainTileSize();
+        if (tileCells == 0 || tileCells > cells)
+        {
+            tileCells = cells;
         }
+        physx::PxQuat rotate(baseInfo.Rotate.X, baseInfo.Rotate.Y, baseInfo.Rotate.Z, baseInfo.Rotate.W);
+        std::vector<int16_t> data;
+        std::vector<uint8_t> tileMaterials;
+        // neighbouring tiles share their edge samples
+        for (unsigned x0 = 0; x0 < cells; x0 += tileCells)
+            for (unsigned z0 = 0; z0 < cells; z0 += tileCells)
+            {
+                unsigned rows = std::min(tileCells, cells - x0) + 1;
+                unsigned columns = std::min(tileCells, cells - z0) + 1;
+                float heightScale;
+                float baseY = quantizeTerrainTile(heights, d, x0, z0, rows, columns, size.Y, data, heightScale);
+
+                TerrainInfo info;
+                physx::PxVec3 offset = rotate.rotate(physx::PxVec3(x0 * cellX, baseY, z0 * cellZ));
+                info.Postion = Vector3{ baseInfo.Postion.X + offset.x, baseInfo.Postion.Y + offset.y, baseInfo.Postion.Z + offset.z };
+                info.Rotate = baseInfo.Rotate;
+                info.Layer = baseInfo.Layer;
+                info.Materials = materials;
+                if (withMaterials)
+                {
+                    transposeTerrainCells(cellMaterials, d, x0, z0, rows - 1, columns - 1, tileMaterials);
+                }
+                if (GetHeightFieldGeometry(info.Geom, data, columns, rows, Vector3{ cellZ, heightScale, cellX }, withMaterials ? &tileMaterials : nullptr)) {
+                    Terrains.emplace_back(info);
+                }
+                else
+                {
+                    assert(false);
+                }
+            }
     }
 
     void SceneInfo::parseSphere(char* &pcontent) {
@@ -221,20 +428,196 @@ namespace PhysxWrap {
     SceneInfoMgr* gSceneInfoMgr = &__gSceneInfoMgr;
 
     std::shared_ptr<SceneInfo> SceneInfoMgr::Get(const std::string &path) {
-        auto it = mScenes.find(path);
-        if (it != mScenes.end())
+        auto scenes = std::atomic_load(&mScenes);
+        auto it = scenes->find(path);
+        if (it != scenes->end())
         {
+            it->second->Touch(mAccessClock.fetch_add(1, std::memory_order_relaxed));
             return it->second;
         }
         return nullptr;
     }
 
-    void SceneInfoMgr::Set(const std::string &path, const std::shared_ptr<SceneInfo> &scene) {
-        if (mScenes.find(path) != mScenes.end())
+    std::shared_ptr<SceneInfo> SceneInfoMgr::GetOrLoad(const std::string &path) {
+        auto sceneInfo = Get(path);
+        if (sceneInfo != nullptr)
         {
-            assert(false);
+            return sceneInfo;
+        }
+
+        std::promise<std::shared_ptr<SceneInfo>> promise;
+        LoadFuture future;
+        uint64_t token = 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            // published while we were waiting for the lock
+            sceneInfo = Get(path);
+            if (sceneInfo != nullptr)
+            {
+                return sceneInfo;
+            }
+            auto it = mLoading.find(path);
+            if (it != mLoading.end())
+            {
+                future = it->second.Future;
+            }
+            else
+            {
+                token = mNextLoadToken++;
+                mLoading[path] = Loading{ token, promise.get_future().share() };
+            }
+        }
+        if (future.valid())
+        {
+            return future.get();
+        }
+
+        try
+        {
+            sceneInfo = std::make_shared<SceneInfo>();
+            if (!sceneInfo->Load(path))
+            {
+                // not cached, the next caller retries
+                sceneInfo = nullptr;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            // the entry must still go and the waiters must still wake up
+            ERROR("[physx] load scene %s failed: %s", path.c_str(), e.what());
+            sceneInfo = nullptr;
+        }
+        if (sceneInfo != nullptr)
+        {
+            sceneInfo->Touch(mAccessClock.fetch_add(1, std::memory_order_relaxed));
+        }
+        std::shared_ptr<const SceneMap> evicted;  // released after the lock
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            // Remove/Clear during the load drop the entry: the waiters still get the result, the cache does not.
+            // A load started after that owns the entry now, only its token may erase or publish
+            auto it = mLoading.find(path);
+            if (it != mLoading.end() && it->second.Token == token)
+            {
+                mLoading.erase(it);
+                if (sceneInfo != nullptr)
+                {
+                    publish(path, sceneInfo);
+                    evicted = evict();
+                }
+            }
+        }
+        promise.set_value(sceneInfo);
+        return sceneInfo;
+    }
+
+    void SceneInfoMgr::publish(const std::string &path, const std::shared_ptr<SceneInfo> &scene) {
+        auto scenes = std::make_shared<SceneMap>(*std::atomic_load(&mScenes));
+        if (scene != nullptr)
+        {
+            (*scenes)[path] = scene;
+        }
+        else
+        {
+            scenes->erase(path);
+        }
+        std::atomic_store(&mScenes, std::shared_ptr<const SceneMap>(scenes));
+    }
+
+    std::shared_ptr<const SceneInfoMgr::SceneMap> SceneInfoMgr::evict() {
+        // caller holds mMutex; returns the evicted scenes so they are released after the lock
+        uint64_t budget = mBudget.load();
+        auto scenes = std::atomic_load(&mScenes);
+        if (budget == 0)
+        {
+            return nullptr;
+        }
+        uint64_t total = 0;
+        std::vector<std::pair<uint64_t, std::string>> idle;
+        for (auto it = scenes->begin(); it != scenes->end(); ++it)
+        {
+            total += it->second->GetBytes();
+            // only the map holds it: no room uses this scene, evicting frees its memory
+            if (it->second.use_count() == 1)
+            {
+                idle.push_back(std::make_pair(it->second->GetLastAccess(), it->first));
+            }
+        }
+        if (total <= budget || idle.empty())
+        {
+            return nullptr;
+        }
+        std::sort(idle.begin(), idle.end());
+        auto kept = std::make_shared<SceneMap>(*scenes);
+        auto evicted = std::make_shared<SceneMap>();
+        for (size_t i = 0; i < idle.size() && total > budget; i++)
+        {
+            auto it = kept->find(idle[i].second);
+            total -= it->second->GetBytes();
+            INFO("evict scene, path = %s, bytes = %llu", it->first.c_str(), (unsigned long long)it->second->GetBytes());
+            (*evicted)[it->first] = it->second;
+            kept->erase(it);
+        }
+        std::atomic_store(&mScenes, std::shared_ptr<const SceneMap>(kept));
+        return evicted;
+    }
+
+    void SceneInfoMgr::SetBudget(uint64_t bytes) {
+        mBudget.store(bytes);
+        std::shared_ptr<const SceneMap> evicted;  // released after the lock
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            evicted = evict();
+        }
+    }
+
+    uint64_t SceneInfoMgr::GetBytes(const std::string &path) {
+        auto scenes = std::atomic_load(&mScenes);
+        auto it = scenes->find(path);
+        return it != scenes->end() ? it->second->GetBytes() : 0;
+    }
+
+    uint64_t SceneInfoMgr::GetTotalBytes() {
+        auto scenes = std::atomic_load(&mScenes);
+        uint64_t total = 0;
+        for (auto it = scenes->begin(); it != scenes->end(); ++it)
+        {
+            total += it->second->GetBytes();
+        }
+        return total;
+    }
+
+    SceneInfoMgr::SceneInfoMgr()
+        : mScenes(std::make_shared<SceneMap>())
+        , mNextLoadToken(1)
+        , mBudget(0)
+        , mAccessClock(1)
+        , mTerrainTileSize(0)
+    {
+
+    }
+
+    SceneInfoMgr::~SceneInfoMgr() {
+        // ReleasePhysxSDK clears the scenes. Any still here at static destruction are leaked on purpose:
+        // ~SceneInfo would reach the mesh registry and the SDK, which may be destroyed first
+        new std::shared_ptr<const SceneMap>(std::move(mScenes));
+        new std::unordered_map<std::string, Loading>(std::move(mLoading));
+    }
+
+    void SceneInfoMgr::Remove(const std::string &path) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLoading.erase(path);
+        publish(path, nullptr);
+    }
+
+    void SceneInfoMgr::Clear() {
+        std::shared_ptr<const SceneMap> scenes = std::make_shared<SceneMap>();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mLoading.clear();
+            scenes = std::atomic_exchange(&mScenes, scenes);
         }
-        mScenes[path] = scene;
+        // the old map (and the scenes no room holds) is released here, outside the lock
     }
 
     unsigned SceneInfoMgr::GetStaticObjCount(const std::string &path) {
@@ -4,9 +4,13 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <future>
 #include <geometry/PxHeightFieldGeometry.h>
 #include <geometry/PxConvexMeshGeometry.h>
 #include "../PhysxWrap.h"
+#include "static_world.h"
 
 namespace PhysxWrap {
 
@@ -17,6 +21,8 @@ namespace PhysxWrap {
         eMeshObj = 4,
         eTerrainObj = 5,
         eSphereObj = 6,
+        eMeshData32 = 7,    // eMeshData with 32-bit indices
+        eTerrainObj2 = 8,   // eTerrainObj with a material table and per-cell material indices / holes
     };
 
     struct ObjInfoBase {
@@ -27,13 +33,10 @@ namespace PhysxWrap {
 
     class MeshInfo : public ObjInfoBase
     {
-        std::vector<float> vb;
-        std::vector<uint16_t> ib;
-        Vector3 scale;
     public:
+        uint64_t MeshId;
+        Vector3 Scale;
         physx::PxTriangleMeshGeometry Geom;
-
-        friend class SceneInfo;
     };
 
     class BoxInfo : public ObjInfoBase
@@ -53,6 +56,7 @@ namespace PhysxWrap {
     {
     public:
         physx::PxHeightFieldGeometry Geom;
+        std::vector<physx::PxMaterial*> Materials;  // owned by the SceneInfo; empty uses the room's material
     };
 
     class SphereInfo : public ObjInfoBase
@@ -69,6 +73,13 @@ namespace PhysxWrap {
 
         bool Load(const std::string path);
 
+        // approximate resident size: cooked meshes (shared ones counted by every map using them), heightfield samples, object lists
+        inline uint64_t GetBytes() const { return mBytes; }
+        inline uint64_t GetLastAccess() const { return mLastAccess.load(std::memory_order_relaxed); }
+        inline void Touch(uint64_t stamp) { mLastAccess.store(stamp, std::memory_order_relaxed); }
+        // shared by every room on this map, safe to query from any thread
+        inline const StaticWorld& GetStaticWorld() const { return mStaticWorld; }
+
         std::vector<MeshInfo> Meshs;
         std::vector<BoxInfo> Boxs;
         std::vector<CapsuleInfo> Capsules;
@@ -80,22 +91,72 @@ namespace PhysxWrap {
         void parseBox(char* &pcontent);
         void parseCapsule(char* &pcontent);
         void parseMesh2(char* &pcontent);
-        void parseTerrain(char* &pcontent);
+        void parseTerrain(char* &pcontent, bool withMaterials);
         void parseObjBaseInfo(char* &pcontent, ObjInfoBase *infobase);
         void parseSphere(char* &pcontent);
+        uint64_t computeBytes();
+
+        struct MeshData {
+            std::vector<float> vb;
+            std::vector<uint16_t> ib;
+            std::vector<uint32_t> ib32;
+            uint64_t MeshId;
+        };
 
         std::string mPath;
+        std::vector<MeshData> mMeshDatas;   // only alive while loading
+        std::vector<uint64_t> mMeshIds;     // registry references held by this scene
+        std::vector<physx::PxMaterial*> mMaterials;
+        StaticWorld mStaticWorld;
+        uint64_t mBytes;
+        std::atomic<uint64_t> mLastAccess;
     };
 
+    // thread-safe: lookups read an immutable snapshot of the map and never wait on mMutex or on a load;
+    // writers copy the map and publish a new snapshot. The snapshot pointer goes through std::atomic_load/store,
+    // which for shared_ptr is not lock-free (the standard libraries use a small pool of spinlocks), only short.
+    // With a byte budget, least recently used scenes no room holds are evicted when a load exceeds it.
     class SceneInfoMgr
     {
     public:
+        SceneInfoMgr();
+        ~SceneInfoMgr();
+
         std::shared_ptr<SceneInfo> Get(const std::string &path);
-        void Set(const std::string &path, const std::shared_ptr<SceneInfo> &scene);
+        // loads a missing scene once: concurrent callers for the same path wait for the first one. nullptr if loading failed
+        std::shared_ptr<SceneInfo> GetOrLoad(const std::string &path);
         unsigned GetStaticObjCount(const std::string &path);
+        void Remove(const std::string &path);
+        void Clear();
+
+        // 0 (default) keeps every scene
+        void SetBudget(uint64_t bytes);
+        uint64_t GetBytes(const std::string &path);
+        uint64_t GetTotalBytes();
+
+        // terrains larger than this many cells per side are split into tiles; 0 keeps one heightfield
+        inline void SetTerrainTileSize(unsigned cells) { mTerrainTileSize.store(cells); }
+        inline unsigned GetTerrainTileSize() { return mTerrainTileSize.load(); }
 
     private:
-        std::unordered_map<std::string, std::shared_ptr<SceneInfo>> mScenes;
+        typedef std::unordered_map<std::string, std::shared_ptr<SceneInfo>> SceneMap;
+        typedef std::shared_future<std::shared_ptr<SceneInfo>> LoadFuture;
+
+        struct Loading {
+            uint64_t Token;     // tells this load from a later one of the same path after Remove/Clear
+            LoadFuture Future;
+        };
+
+        void publish(const std::string &path, const std::shared_ptr<SceneInfo> &scene);
+        std::shared_ptr<const SceneMap> evict();
+
+        std::shared_ptr<const SceneMap> mScenes;    // accessed with std::atomic_load/atomic_store only
+        std::mutex mMutex;                          // serializes writers and guards mLoading
+        std::unordered_map<std::string, Loading> mLoading;
+        uint64_t mNextLoadToken;                    // guarded by mMutex
+        std::atomic<uint64_t> mBudget;
+        std::atomic<uint64_t> mAccessClock;
+        std::atomic<unsigned> mTerrainTileSize;
     };
 
     extern SceneInfoMgr* gSceneInfoMgr;
@@ -0,0 +1,127 @@
+#include "simulation_events.h"
+#include <PxRigidActor.h>
+#include <cstring>
+
+#define DEFAULT_EVENT_CAPACITY (1024)
+#define MAX_PAIR_POINTS (8)
+
+namespace PhysxWrap {
+
+    static_assert(sizeof(PhysicsEvent) == 48, "PhysicsEvent layout is shared with the go side");
+
+    physx::PxFilterFlags SimulationFilterShader(
+        physx::PxFilterObjectAttributes attributes0, physx::PxFilterData filterData0,
+        physx::PxFilterObjectAttributes attributes1, physx::PxFilterData filterData1,
+        physx::PxPairFlags& pairFlags, const void* constantBlock, physx::PxU32 constantBlockSize) {
+        if (physx::PxFilterObjectIsTrigger(attributes0) || physx::PxFilterObjectIsTrigger(attributes1)) {
+            pairFlags = physx::PxPairFlag::eTRIGGER_DEFAULT;
+            return physx::PxFilterFlag::eDEFAULT;
+        }
+        pairFlags = physx::PxPairFlag::eCONTACT_DEFAULT;
+        if (constantBlockSize >= sizeof(FilterShaderData) && (((const FilterShaderData*)constantBlock)->Flags & FilterShaderData::eCCD)) {
+            pairFlags |= physx::PxPairFlag::eDETECT_CCD_CONTACT;
+        }
+        if ((filterData0.word3 | filterData1.word3) & eFilterReportContacts) {
+            pairFlags |= physx::PxPairFlag::eNOTIFY_TOUCH_FOUND;
+            pairFlags |= physx::PxPairFlag::eNOTIFY_TOUCH_LOST;
+            pairFlags |= physx::PxPairFlag::eNOTIFY_CONTACT_POINTS;
+        }
+        return physx::PxFilterFlag::eDEFAULT;
+    }
+
+    SimulationEvents::SimulationEvents()
+        : mEvents(DEFAULT_EVENT_CAPACITY)
+        , mCount(0)
+        , mDropped(0)
+    {
+
+    }
+
+    void SimulationEvents::SetCapacity(unsigned capacity) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEvents.resize(capacity);
+        if (mCount > capacity) {
+            mDropped += mCount - capacity;
+            mCount = capacity;
+        }
+    }
+
+    unsigned SimulationEvents::Drain(PhysicsEvent *buffer, unsigned capacity) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        unsigned count = mCount < capacity ? mCount : capacity;
+        if (count > 0) {
+            memcpy(buffer, mEvents.data(), count * sizeof(PhysicsEvent));
+            // keep what did not fit for the next call
+            memmove(mEvents.data(), mEvents.data() + count, (mCount - count) * sizeof(PhysicsEvent));
+            mCount -= count;
+        }
+        return count;
+    }
+
+    unsigned SimulationEvents::GetDropped() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        unsigned dropped = mDropped;
+        mDropped = 0;
+        return dropped;
+    }
+
+    void SimulationEvents::onContact(const physx::PxContactPairHeader& pairHeader, const physx::PxContactPair* pairs, physx::PxU32 nbPairs) {
+        if (pairHeader.flags & (physx::PxContactPairHeaderFlag::eREMOVED_ACTOR_0 | physx::PxContactPairHeaderFlag::eREMOVED_ACTOR_1)) {
+            return;
+        }
+        physx::PxContactPairPoint points[MAX_PAIR_POINTS];
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (physx::PxU32 i = 0; i < nbPairs; i++) {
+            const physx::PxContactPair &pair = pairs[i];
+            unsigned type;
+            if (pair.events & physx::PxPairFlag::eNOTIFY_TOUCH_FOUND) {
+                type = eContactBegin;
+            }
+            else if (pair.events & physx::PxPairFlag::eNOTIFY_TOUCH_LOST) {
+                type = eContactEnd;
+            }
+            else {
+                continue;
+            }
+            if (mCount >= mEvents.size()) {
+                mDropped++;
+                continue;
+            }
+            PhysicsEvent &ev = mEvents[mCount++];
+            memset(&ev, 0, sizeof(ev));
+            ev.Type = type;
+            ev.Id0 = (uint64_t)pairHeader.actors[0];
+            ev.Id1 = (uint64_t)pairHeader.actors[1];
+            physx::PxU32 count = pair.contactCount > 0 ? pair.extractContacts(points, MAX_PAIR_POINTS) : 0;
+            if (count > 0) {
+                physx::PxVec3 impulse(0.0f);
+                for (physx::PxU32 j = 0; j < count; j++) {
+                    impulse += points[j].impulse;
+                }
+                ev.Point = Vector3{ points[0].position.x, points[0].position.y, points[0].position.z };
+                ev.Normal = Vector3{ points[0].normal.x, points[0].normal.y, points[0].normal.z };
+                ev.Impulse = impulse.magnitude();
+            }
+        }
+    }
+
+    void SimulationEvents::onTrigger(physx::PxTriggerPair* pairs, physx::PxU32 count) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (physx::PxU32 i = 0; i < count; i++) {
+            const physx::PxTriggerPair &pair = pairs[i];
+            if (pair.flags & (physx::PxTriggerPairFlag::eREMOVED_SHAPE_TRIGGER | physx::PxTriggerPairFlag::eREMOVED_SHAPE_OTHER)) {
+                continue;
+            }
+            if (mCount >= mEvents.size()) {
+                mDropped++;
+                continue;
+            }
+            PhysicsEvent &ev = mEvents[mCount++];
+            memset(&ev, 0, sizeof(ev));
+            ev.Type = pair.status == physx::PxPairFlag::eNOTIFY_TOUCH_FOUND ? eTriggerEnter : eTriggerExit;
+            ev.Id0 = (uint64_t)pair.triggerActor;
+            ev.Id1 = (uint64_t)pair.otherActor;
+        }
+    }
+
+}
@@ -0,0 +1,56 @@
+#ifndef __SIMULATION_EVENTS_H__
+#define __SIMULATION_EVENTS_H__
+
+#include <PxSimulationEventCallback.h>
+#include <PxFiltering.h>
+#include <mutex>
+#include <vector>
+#include "../PhysxWrap.h"
+
+namespace PhysxWrap {
+
+    // filter data word3 bits
+    enum {
+        eFilterReportContacts = 1,
+    };
+
+    // constant block handed to SimulationFilterShader through PxSceneDesc::filterShaderData
+    struct FilterShaderData {
+        enum {
+            eCCD = 1,
+        };
+        uint32_t Flags;
+    };
+
+    physx::PxFilterFlags SimulationFilterShader(
+        physx::PxFilterObjectAttributes attributes0, physx::PxFilterData filterData0,
+        physx::PxFilterObjectAttributes attributes1, physx::PxFilterData filterData1,
+        physx::PxPairFlags& pairFlags, const void* constantBlock, physx::PxU32 constantBlockSize);
+
+    // collects contact/trigger events during fetchResults into a fixed-size array; events past the capacity are dropped.
+    class SimulationEvents : public physx::PxSimulationEventCallback
+    {
+    public:
+        SimulationEvents();
+
+        void SetCapacity(unsigned capacity);
+        unsigned Drain(PhysicsEvent *buffer, unsigned capacity);
+        unsigned GetDropped();
+
+        virtual void onContact(const physx::PxContactPairHeader& pairHeader, const physx::PxContactPair* pairs, physx::PxU32 nbPairs);
+        virtual void onTrigger(physx::PxTriggerPair* pairs, physx::PxU32 count);
+        virtual void onConstraintBreak(physx::PxConstraintInfo*, physx::PxU32) {}
+        virtual void onWake(physx::PxActor**, physx::PxU32) {}
+        virtual void onSleep(physx::PxActor**, physx::PxU32) {}
+        virtual void onAdvance(const physx::PxRigidBody*const*, const physx::PxTransform*, const physx::PxU32) {}
+
+    private:
+        std::mutex mMutex;
+        std::vector<PhysicsEvent> mEvents;  // preallocated, mCount used
+        unsigned mCount;
+        unsigned mDropped;
+    };
+
+};
+
+#endif
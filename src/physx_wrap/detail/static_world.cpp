@@ -0,0 +1,329 @@
+#include "static_world.h"
+#include "scene_info_mgr.h"
+#include <geometry/PxGeometryQuery.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define STATIC_WORLD_SSE
+#include <xmmintrin.h>
+#endif
+
+#define PACKET_SIZE (4)
+#define MAX_LEAF_PRIMS (4)
+#define MAX_TRAVERSAL_DEPTH (64)
+#define MIN_RAY_DIR (1e-8f)
+#define GROUND_RAY_MARGIN (1.0f)
+
+namespace PhysxWrap {
+
+    // rays of one packet in SoA layout; unused lanes have MaxDist < 0 and never hit
+    struct RayPacket {
+        alignas(16) float Origin[3][PACKET_SIZE];
+        alignas(16) float InvDir[3][PACKET_SIZE];
+        alignas(16) float MaxDist[PACKET_SIZE];
+    };
+
+    // bit i set when ray i crosses [min, max] within [0, MaxDist]
+    static unsigned slabTest(const RayPacket &packet, const float *min, const float *max) {
+#ifdef STATIC_WORLD_SSE
+        __m128 tNear = _mm_setzero_ps();
+        __m128 tFar = _mm_load_ps(packet.MaxDist);
+        for (int axis = 0; axis < 3; axis++) {
+            __m128 origin = _mm_load_ps(packet.Origin[axis]);
+            __m128 invDir = _mm_load_ps(packet.InvDir[axis]);
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(min[axis]), origin), invDir);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(max[axis]), origin), invDir);
+            tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+            tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+        }
+        return unsigned(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)));
+#else
+        unsigned mask = 0;
+        for (int lane = 0; lane < PACKET_SIZE; lane++) {
+            float tNear = 0.0f;
+            float tFar = packet.MaxDist[lane];
+            for (int axis = 0; axis < 3; axis++) {
+                float t0 = (min[axis] - packet.Origin[axis][lane]) * packet.InvDir[axis][lane];
+                float t1 = (max[axis] - packet.Origin[axis][lane]) * packet.InvDir[axis][lane];
+                tNear = std::max(tNear, std::min(t0, t1));
+                tFar = std::min(tFar, std::max(t0, t1));
+            }
+            if (tNear <= tFar) {
+                mask |= 1u << lane;
+            }
+        }
+        return mask;
+#endif
+    }
+
+    StaticWorld::StaticWorld() {
+
+    }
+
+    void StaticWorld::Build(const SceneInfo &info) {
+        mPrims.clear();
+        mPrimIndices.clear();
+        mNodes.clear();
+        mTerrains.Clear();
+        for (size_t i = 0; i < info.Terrains.size(); i++)
+        {
+            addPrim(info.Terrains[i].Geom, info.Terrains[i].Postion, info.Terrains[i].Rotate);
+        }
+        for (size_t i = 0; i < info.Boxs.size(); i++)
+        {
+            auto &box = info.Boxs[i];
+            addPrim(physx::PxBoxGeometry(box.Half.X, box.Half.Y, box.Half.Z), box.Postion, box.Rotate);
+        }
+        for (size_t i = 0; i < info.Capsules.size(); i++)
+        {
+            auto &capsule = info.Capsules[i];
+            addPrim(physx::PxCapsuleGeometry(capsule.Radius, capsule.HalfHeight), capsule.Postion, capsule.Rotate);
+        }
+        for (size_t i = 0; i < info.Meshs.size(); i++)
+        {
+            addPrim(info.Meshs[i].Geom, info.Meshs[i].Postion, info.Meshs[i].Rotate);
+        }
+        for (size_t i = 0; i < info.Spheres.size(); i++)
+        {
+            addPrim(physx::PxSphereGeometry(info.Spheres[i].Radius), info.Spheres[i].Postion, info.Spheres[i].Rotate);
+        }
+        if (mPrims.empty()) {
+            return;
+        }
+
+        std::vector<physx::PxBounds3> bounds(mPrims.size());
+        mPrimIndices.resize(mPrims.size());
+        for (size_t i = 0; i < mPrims.size(); i++)
+        {
+            bounds[i] = physx::PxGeometryQuery::getWorldBounds(mPrims[i].Geom.any(), mPrims[i].Pose);
+            mPrimIndices[i] = uint32_t(i);
+        }
+        // terrains come first
+        for (size_t i = 0; i < mPrims.size(); i++)
+        {
+            if (i < info.Terrains.size()) {
+                mTerrains.AddTerrain(info.Terrains[i].Geom, mPrims[i].Pose);
+            }
+            else if (!mTerrains.Empty()) {
+                mTerrains.MarkCovered(bounds[i]);
+            }
+        }
+        mNodes.reserve(2 * mPrims.size() / MAX_LEAF_PRIMS + 1);
+        mNodes.push_back(Node());
+        buildNode(0, 0, uint32_t(mPrims.size()), bounds);
+        mNodes.shrink_to_fit();
+    }
+
+    void StaticWorld::addPrim(const physx::PxGeometry &geom, const Vector3 &pos, const Quat &rotate) {
+        Prim prim;
+        prim.Geom.storeAny(geom);
+        prim.Pose = physx::PxTransform(physx::PxVec3(pos.X, pos.Y, pos.Z), physx::PxQuat(rotate.X, rotate.Y, rotate.Z, rotate.W));
+        mPrims.push_back(prim);
+    }
+
+    // median split along the longest axis of the centroids; keeps the tree balanced so the depth stays near log2(n)
+    void StaticWorld::buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, std::vector<physx::PxBounds3> &bounds) {
+        physx::PxBounds3 nodeBounds = physx::PxBounds3::empty();
+        physx::PxBounds3 centers = physx::PxBounds3::empty();
+        for (uint32_t i = begin; i < end; i++)
+        {
+            nodeBounds.include(bounds[mPrimIndices[i]]);
+            centers.include(bounds[mPrimIndices[i]].getCenter());
+        }
+        Node &node = mNodes[nodeIndex];
+        for (int axis = 0; axis < 3; axis++) {
+            node.Min[axis] = nodeBounds.minimum[axis];
+            node.Max[axis] = nodeBounds.maximum[axis];
+        }
+        if (end - begin <= MAX_LEAF_PRIMS) {
+            node.First = begin;
+            node.Count = uint16_t(end - begin);
+            node.Axis = 0;
+            return;
+        }
+
+        physx::PxVec3 extents = centers.getExtents();
+        uint16_t axis = extents.x >= extents.y && extents.x >= extents.z ? 0 : (extents.y >= extents.z ? 1 : 2);
+        uint32_t middle = begin + (end - begin) / 2;
+        std::nth_element(mPrimIndices.begin() + begin, mPrimIndices.begin() + middle, mPrimIndices.begin() + end,
+            [&bounds, axis](uint32_t a, uint32_t b) { return bounds[a].getCenter()[axis] < bounds[b].getCenter()[axis]; });
+
+        uint32_t first = uint32_t(mNodes.size());
+        node.First = first;
+        node.Count = 0;
+        node.Axis = axis;
+        // node is invalid after this
+        mNodes.push_back(Node());
+        mNodes.push_back(Node());
+        buildNode(first, begin, middle, bounds);
+        buildNode(first + 1, middle, end, bounds);
+    }
+
+    bool StaticWorld::Raycast(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) const {
+        uint8_t found = 0;
+        raycastPacket(&origin, &unitDir, &distance, 1, &hit, &found);
+        return found != 0;
+    }
+
+    void StaticWorld::RaycastBatch(const Vector3 *origins, const Vector3 *unitDirs, const float *distances, unsigned count, RaycastHit *hits, uint8_t *outHit) const {
+        for (unsigned i = 0; i < count; i += PACKET_SIZE) {
+            unsigned packetCount = std::min(count - i, unsigned(PACKET_SIZE));
+            raycastPacket(origins + i, unitDirs + i, distances + i, packetCount, hits + i, outHit + i);
+        }
+    }
+
+    void StaticWorld::raycastPacket(const Vector3 *origins, const Vector3 *unitDirs, const float *distances, unsigned count, RaycastHit *hits, uint8_t *outHit) const {
+        RayPacket packet;
+        for (unsigned lane = 0; lane < PACKET_SIZE; lane++) {
+            if (lane < count) {
+                const float origin[3] = { origins[lane].X, origins[lane].Y, origins[lane].Z };
+                const float dir[3] = { unitDirs[lane].X, unitDirs[lane].Y, unitDirs[lane].Z };
+                for (int axis = 0; axis < 3; axis++) {
+                    // keep the slab test free of 0 * inf
+                    float d = std::fabs(dir[axis]) > MIN_RAY_DIR ? dir[axis] : (dir[axis] < 0.0f ? -MIN_RAY_DIR : MIN_RAY_DIR);
+                    packet.Origin[axis][lane] = origin[axis];
+                    packet.InvDir[axis][lane] = 1.0f / d;
+                }
+                packet.MaxDist[lane] = distances[lane];
+                outHit[lane] = 0;
+            }
+            else {
+                for (int axis = 0; axis < 3; axis++) {
+                    packet.Origin[axis][lane] = 0.0f;
+                    packet.InvDir[axis][lane] = 1.0f;
+                }
+                packet.MaxDist[lane] = -1.0f;
+            }
+        }
+        if (mNodes.empty()) {
+            return;
+        }
+
+        uint32_t stack[MAX_TRAVERSAL_DEPTH];
+        unsigned top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = mNodes[stack[--top]];
+            unsigned mask = slabTest(packet, node.Min, node.Max);
+            if (mask == 0) {
+                continue;
+            }
+            if (node.Count > 0) {
+                for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+                    uint32_t primIndex = mPrimIndices[i];
+                    const Prim &prim = mPrims[primIndex];
+                    for (unsigned lane = 0; lane < count; lane++) {
+                        if (!(mask & (1u << lane))) {
+                            continue;
+                        }
+                        physx::PxRaycastHit rayHit;
+                        physx::PxVec3 origin(origins[lane].X, origins[lane].Y, origins[lane].Z);
+                        physx::PxVec3 dir(unitDirs[lane].X, unitDirs[lane].Y, unitDirs[lane].Z);
+                        if (physx::PxGeometryQuery::raycast(origin, dir, prim.Geom.any(), prim.Pose, packet.MaxDist[lane], physx::PxHitFlag::eDEFAULT, 1, &rayHit) > 0) {
+                            // closer hits only from here on
+                            packet.MaxDist[lane] = rayHit.distance;
+                            outHit[lane] = 1;
+                            hits[lane].Id = primIndex;
+                            hits[lane].Postion = Vector3{ rayHit.position.x, rayHit.position.y, rayHit.position.z };
+                            hits[lane].Normal = Vector3{ rayHit.normal.x, rayHit.normal.y, rayHit.normal.z };
+                            hits[lane].Distance = rayHit.distance;
+                        }
+                    }
+                }
+                continue;
+            }
+            if (top + 2 > MAX_TRAVERSAL_DEPTH) {
+                continue;
+            }
+            // visit the near child first, as seen by the first active ray
+            unsigned lane = 0;
+            while (!(mask & (1u << lane))) {
+                lane++;
+            }
+            bool reversed = packet.InvDir[node.Axis][lane] < 0.0f;
+            stack[top++] = reversed ? node.First : node.First + 1;
+            stack[top++] = reversed ? node.First + 1 : node.First;
+        }
+    }
+
+    unsigned StaticWorld::OverlapSphere(const Vector3 &center, float radius, uint32_t *indices, unsigned capacity) const {
+        if (mNodes.empty()) {
+            return 0;
+        }
+        physx::PxSphereGeometry sphere(radius);
+        physx::PxTransform pose(physx::PxVec3(center.X, center.Y, center.Z));
+        const float c[3] = { center.X, center.Y, center.Z };
+        unsigned found = 0;
+        uint32_t stack[MAX_TRAVERSAL_DEPTH];
+        unsigned top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = mNodes[stack[--top]];
+            float distSq = 0.0f;
+            for (int axis = 0; axis < 3; axis++) {
+                float d = std::max(std::max(node.Min[axis] - c[axis], c[axis] - node.Max[axis]), 0.0f);
+                distSq += d * d;
+            }
+            if (distSq > radius * radius) {
+                continue;
+            }
+            if (node.Count > 0) {
+                for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+                    const Prim &prim = mPrims[mPrimIndices[i]];
+                    if (physx::PxGeometryQuery::overlap(sphere, pose, prim.Geom.any(), prim.Pose)) {
+                        if (found < capacity) {
+                            indices[found] = mPrimIndices[i];
+                        }
+                        found++;
+                    }
+                }
+            }
+            else if (top + 2 <= MAX_TRAVERSAL_DEPTH) {
+                stack[top++] = node.First;
+                stack[top++] = node.First + 1;
+            }
+        }
+        return found;
+    }
+
+    void StaticWorld::SampleHeights(const float *xz, unsigned count, float *heights, uint8_t *outHit) const {
+        mTerrains.Sample(xz, count, heights, outHit);
+        std::vector<unsigned> pending;
+        for (unsigned i = 0; i < count; i++) {
+            if (outHit[i] == TerrainSampler::eSampleRaycast) {
+                pending.push_back(i);
+            }
+            outHit[i] = outHit[i] == TerrainSampler::eSampleHit ? 1 : 0;
+        }
+        if (pending.empty() || mNodes.empty()) {
+            return;
+        }
+
+        // straight down from above every object
+        const Node &root = mNodes[0];
+        float top = root.Max[1] + GROUND_RAY_MARGIN;
+        float distance = top - root.Min[1] + GROUND_RAY_MARGIN;
+        unsigned rayCount = unsigned(pending.size());
+        std::vector<Vector3> origins(rayCount);
+        std::vector<Vector3> unitDirs(rayCount, Vector3{ 0.0f, -1.0f, 0.0f });
+        std::vector<float> distances(rayCount, distance);
+        std::vector<RaycastHit> hits(rayCount);
+        std::vector<uint8_t> rayHit(rayCount);
+        for (unsigned k = 0; k < rayCount; k++) {
+            unsigned i = pending[k];
+            origins[k] = Vector3{ xz[i * 2], top, xz[i * 2 + 1] };
+        }
+        RaycastBatch(origins.data(), unitDirs.data(), distances.data(), rayCount, hits.data(), rayHit.data());
+        for (unsigned k = 0; k < rayCount; k++) {
+            unsigned i = pending[k];
+            outHit[i] = rayHit[k];
+            heights[i] = rayHit[k] ? hits[k].Postion.Y : 0.0f;
+        }
+    }
+
+    uint64_t StaticWorld::GetBytes() const {
+        return mPrims.capacity() * sizeof(Prim) + mPrimIndices.capacity() * sizeof(uint32_t) + mNodes.capacity() * sizeof(Node) + mTerrains.GetBytes();
+    }
+
+}
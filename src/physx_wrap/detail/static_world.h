@@ -0,0 +1,63 @@
+#ifndef __STATIC_WORLD_H__
+#define __STATIC_WORLD_H__
+
+#include <geometry/PxGeometryHelpers.h>
+#include <foundation/PxTransform.h>
+#include <vector>
+#include "../PhysxWrap.h"
+#include "terrain_sampler.h"
+
+namespace PhysxWrap {
+
+    class SceneInfo;
+
+    // immutable bounding volume hierarchy over the static objects of one SceneInfo.
+    // Built once after loading; every query is const, so any thread may use it without a scene or a lock.
+    // Hit ids are object indices in CreateScene order (terrains, boxes, capsules, meshes, spheres).
+    class StaticWorld
+    {
+    public:
+        StaticWorld();
+
+        void Build(const SceneInfo &info);
+
+        bool Raycast(const Vector3 &origin, const Vector3 &unitDir, float distance, RaycastHit &hit) const;
+        // rays are traversed in packets of 4; outHit[i] is 1 when hits[i] is valid
+        void RaycastBatch(const Vector3 *origins, const Vector3 *unitDirs, const float *distances, unsigned count, RaycastHit *hits, uint8_t *outHit) const;
+        // indices of the objects touching the sphere, at most `capacity`; returns the total found
+        unsigned OverlapSphere(const Vector3 &center, float radius, uint32_t *indices, unsigned capacity) const;
+        // ground height under x,z pairs: read from the terrains, with downward rays only where other objects overlap them.
+        // outHit[i] is 1 when heights[i] is valid
+        void SampleHeights(const float *xz, unsigned count, float *heights, uint8_t *outHit) const;
+        inline const TerrainSampler& GetTerrainSampler() const { return mTerrains; }
+
+        uint64_t GetBytes() const;
+
+    private:
+        struct Prim {
+            physx::PxGeometryHolder Geom;
+            physx::PxTransform Pose;
+        };
+
+        // inner nodes (Count == 0) keep their children at First and First + 1
+        struct Node {
+            float Min[3];
+            float Max[3];
+            uint32_t First;
+            uint16_t Count;
+            uint16_t Axis;
+        };
+
+        void addPrim(const physx::PxGeometry &geom, const Vector3 &pos, const Quat &rotate);
+        void buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, std::vector<physx::PxBounds3> &bounds);
+        void raycastPacket(const Vector3 *origins, const Vector3 *unitDirs, const float *distances, unsigned count, RaycastHit *hits, uint8_t *outHit) const;
+
+        std::vector<Prim> mPrims;
+        std::vector<uint32_t> mPrimIndices;     // leaf ranges point into this list
+        std::vector<Node> mNodes;
+        TerrainSampler mTerrains;               // the terrain prims, with the cells other prims overlap marked
+    };
+
+};
+
+#endif
@@ -0,0 +1,282 @@
+#include "terrain_sampler.h"
+#include <geometry/PxGeometryQuery.h>
+#include <geometry/PxHeightField.h>
+#include <geometry/PxHeightFieldSample.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TERRAIN_SAMPLER_SSE
+#include <xmmintrin.h>
+#endif
+
+#define PACKET_SIZE (4)
+#define MAX_TILT (1e-4f)
+
+namespace PhysxWrap {
+
+    // corner heights and fractions of 4 points in SoA layout; unused lanes are zero
+    struct CellPacket {
+        alignas(16) float H00[PACKET_SIZE];     // (row, column)
+        alignas(16) float H01[PACKET_SIZE];     // (row, column + 1)
+        alignas(16) float H10[PACKET_SIZE];     // (row + 1, column)
+        alignas(16) float H11[PACKET_SIZE];     // (row + 1, column + 1)
+        alignas(16) float FracX[PACKET_SIZE];   // along the rows
+        alignas(16) float FracZ[PACKET_SIZE];   // along the columns
+        alignas(16) float Shared[PACKET_SIZE];  // 1 when the cell is split through H00-H11, else through H01-H10
+    };
+
+    // height on the cell triangle under each point, as PhysX's heightfield interpolates it
+    static void interpolate(const CellPacket &cells, float *out) {
+#ifdef TERRAIN_SAMPLER_SSE
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 h00 = _mm_load_ps(cells.H00);
+        __m128 h01 = _mm_load_ps(cells.H01);
+        __m128 h10 = _mm_load_ps(cells.H10);
+        __m128 h11 = _mm_load_ps(cells.H11);
+        __m128 fx = _mm_load_ps(cells.FracX);
+        __m128 fz = _mm_load_ps(cells.FracZ);
+        // split through H01-H10
+        __m128 lower = _mm_add_ps(h00, _mm_add_ps(_mm_mul_ps(fz, _mm_sub_ps(h01, h00)), _mm_mul_ps(fx, _mm_sub_ps(h10, h00))));
+        __m128 upper = _mm_add_ps(h11, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(one, fz), _mm_sub_ps(h10, h11)), _mm_mul_ps(_mm_sub_ps(one, fx), _mm_sub_ps(h01, h11))));
+        __m128 isLower = _mm_cmplt_ps(_mm_add_ps(fx, fz), one);
+        __m128 split = _mm_or_ps(_mm_and_ps(isLower, lower), _mm_andnot_ps(isLower, upper));
+        // split through H00-H11
+        __m128 right = _mm_add_ps(h00, _mm_add_ps(_mm_mul_ps(fz, _mm_sub_ps(h01, h00)), _mm_mul_ps(fx, _mm_sub_ps(h11, h01))));
+        __m128 left = _mm_add_ps(h00, _mm_add_ps(_mm_mul_ps(fx, _mm_sub_ps(h10, h00)), _mm_mul_ps(fz, _mm_sub_ps(h11, h10))));
+        __m128 isRight = _mm_cmpgt_ps(fz, fx);
+        __m128 shared = _mm_or_ps(_mm_and_ps(isRight, right), _mm_andnot_ps(isRight, left));
+        __m128 isShared = _mm_cmpgt_ps(_mm_load_ps(cells.Shared), _mm_setzero_ps());
+        _mm_storeu_ps(out, _mm_or_ps(_mm_and_ps(isShared, shared), _mm_andnot_ps(isShared, split)));
+#else
+        for (int lane = 0; lane < PACKET_SIZE; lane++) {
+            float h00 = cells.H00[lane], h01 = cells.H01[lane], h10 = cells.H10[lane], h11 = cells.H11[lane];
+            float fx = cells.FracX[lane], fz = cells.FracZ[lane];
+            if (cells.Shared[lane] > 0.0f) {
+                out[lane] = fz > fx
+                    ? h00 + fz * (h01 - h00) + fx * (h11 - h01)
+                    : h00 + fx * (h10 - h00) + fz * (h11 - h10);
+            }
+            else {
+                out[lane] = fx + fz < 1.0f
+                    ? h00 + fz * (h01 - h00) + fx * (h10 - h00)
+                    : h11 + (1.0f - fz) * (h10 - h11) + (1.0f - fx) * (h01 - h11);
+            }
+        }
+#endif
+    }
+
+    TerrainSampler::TerrainSampler() {
+
+    }
+
+    void TerrainSampler::Clear() {
+        mTerrains.clear();
+    }
+
+    void TerrainSampler::AddTerrain(const physx::PxHeightFieldGeometry &geom, const physx::PxTransform &pose) {
+        auto hf = geom.heightField;
+        if (hf == nullptr || hf->getNbRows() < 2 || hf->getNbColumns() < 2) {
+            return;
+        }
+        Terrain terrain;
+        terrain.Origin[0] = pose.p.x;
+        terrain.Origin[1] = pose.p.y;
+        terrain.Origin[2] = pose.p.z;
+        physx::PxVec3 axisX = pose.q.rotate(physx::PxVec3(1.0f, 0.0f, 0.0f));
+        physx::PxVec3 axisY = pose.q.rotate(physx::PxVec3(0.0f, 1.0f, 0.0f));
+        physx::PxVec3 axisZ = pose.q.rotate(physx::PxVec3(0.0f, 0.0f, 1.0f));
+        terrain.AxisX[0] = axisX.x;
+        terrain.AxisX[1] = axisX.z;
+        terrain.AxisZ[0] = axisZ.x;
+        terrain.AxisZ[1] = axisZ.z;
+        terrain.RowScale = geom.rowScale;
+        terrain.ColumnScale = geom.columnScale;
+        terrain.HeightScale = geom.heightScale;
+        terrain.Rows = hf->getNbRows();
+        terrain.Columns = hf->getNbColumns();
+        terrain.Tilted = axisY.y < 1.0f - MAX_TILT;
+        terrain.Bounds = physx::PxGeometryQuery::getWorldBounds(geom, pose);
+        if (!terrain.Tilted) {
+            std::vector<physx::PxHeightFieldSample> samples(size_t(terrain.Rows) * terrain.Columns);
+            hf->saveCells(samples.data(), physx::PxU32(samples.size() * sizeof(physx::PxHeightFieldSample)));
+            terrain.Heights.resize(samples.size());
+            for (size_t i = 0; i < samples.size(); i++)
+            {
+                terrain.Heights[i] = float(samples[i].height);
+            }
+            // a cell's tess flag and triangle materials live in its first sample
+            terrain.Cells.resize(size_t(terrain.Rows - 1) * (terrain.Columns - 1));
+            for (unsigned row = 0; row + 1 < terrain.Rows; row++)
+                for (unsigned col = 0; col + 1 < terrain.Columns; col++)
+                {
+                    auto &sample = samples[row * terrain.Columns + col];
+                    uint8_t flags = sample.tessFlag() ? eCellShared : 0;
+                    if ((sample.materialIndex0 & 0x7f) == physx::PxHeightFieldMaterial::eHOLE || (sample.materialIndex1 & 0x7f) == physx::PxHeightFieldMaterial::eHOLE) {
+                        flags |= eCellHole;
+                    }
+                    terrain.Cells[row * (terrain.Columns - 1) + col] = flags;
+                }
+        }
+        mTerrains.push_back(std::move(terrain));
+    }
+
+    void TerrainSampler::MarkCovered(const physx::PxBounds3 &bounds) {
+        for (size_t i = 0; i < mTerrains.size(); i++)
+        {
+            auto &terrain = mTerrains[i];
+            // tilted terrains send every point to raycasts already; ground wholly below the terrain never shows from above
+            if (terrain.Tilted || bounds.maximum.y < terrain.Bounds.minimum.y
+                || bounds.minimum.x > terrain.Bounds.maximum.x || bounds.maximum.x < terrain.Bounds.minimum.x
+                || bounds.minimum.z > terrain.Bounds.maximum.z || bounds.maximum.z < terrain.Bounds.minimum.z) {
+                continue;
+            }
+            // cell range of the footprint's corners, conservative under yaw
+            float minX = FLT_MAX, maxX = -FLT_MAX, minZ = FLT_MAX, maxZ = -FLT_MAX;
+            for (int corner = 0; corner < 4; corner++) {
+                float dx = (corner & 1 ? bounds.maximum.x : bounds.minimum.x) - terrain.Origin[0];
+                float dz = (corner & 2 ? bounds.maximum.z : bounds.minimum.z) - terrain.Origin[2];
+                float fx = (dx * terrain.AxisX[0] + dz * terrain.AxisX[1]) / terrain.RowScale;
+                float fz = (dx * terrain.AxisZ[0] + dz * terrain.AxisZ[1]) / terrain.ColumnScale;
+                minX = std::min(minX, fx);
+                maxX = std::max(maxX, fx);
+                minZ = std::min(minZ, fz);
+                maxZ = std::max(maxZ, fz);
+            }
+            int rowEnd = int(terrain.Rows) - 2;
+            int colEnd = int(terrain.Columns) - 2;
+            int row0 = int(std::floor(std::max(minX, 0.0f)));
+            int row1 = int(std::floor(std::min(maxX, float(rowEnd))));
+            int col0 = int(std::floor(std::max(minZ, 0.0f)));
+            int col1 = int(std::floor(std::min(maxZ, float(colEnd))));
+            for (int row = row0; row <= row1; row++)
+                for (int col = col0; col <= col1; col++)
+                {
+                    terrain.Cells[row * (terrain.Columns - 1) + col] |= eCellCovered;
+                }
+        }
+    }
+
+    void TerrainSampler::Sample(const float *xz, unsigned count, float *heights, uint8_t *state) const {
+        for (unsigned i = 0; i < count; i++) {
+            heights[i] = -FLT_MAX;
+            state[i] = eSampleMiss;
+        }
+        alignas(16) float px[PACKET_SIZE];
+        alignas(16) float pz[PACKET_SIZE];
+        for (unsigned base = 0; base < count; base += PACKET_SIZE) {
+            unsigned n = std::min(count - base, unsigned(PACKET_SIZE));
+            float minX = FLT_MAX, maxX = -FLT_MAX, minZ = FLT_MAX, maxZ = -FLT_MAX;
+            for (unsigned lane = 0; lane < PACKET_SIZE; lane++) {
+                // unused lanes repeat the last point
+                unsigned i = base + std::min(lane, n - 1);
+                px[lane] = xz[i * 2];
+                pz[lane] = xz[i * 2 + 1];
+                minX = std::min(minX, px[lane]);
+                maxX = std::max(maxX, px[lane]);
+                minZ = std::min(minZ, pz[lane]);
+                maxZ = std::max(maxZ, pz[lane]);
+            }
+            for (size_t t = 0; t < mTerrains.size(); t++)
+            {
+                auto &bounds = mTerrains[t].Bounds;
+                if (minX > bounds.maximum.x || maxX < bounds.minimum.x || minZ > bounds.maximum.z || maxZ < bounds.minimum.z) {
+                    continue;
+                }
+                samplePacket(mTerrains[t], px, pz, n, heights + base, state + base);
+            }
+        }
+        for (unsigned i = 0; i < count; i++) {
+            if (state[i] != eSampleHit) {
+                heights[i] = 0.0f;
+            }
+        }
+    }
+
+    void TerrainSampler::samplePacket(const Terrain &terrain, const float *px, const float *pz, unsigned count, float *heights, uint8_t *state) {
+        if (terrain.Tilted) {
+            for (unsigned lane = 0; lane < count; lane++) {
+                if (px[lane] >= terrain.Bounds.minimum.x && px[lane] <= terrain.Bounds.maximum.x
+                    && pz[lane] >= terrain.Bounds.minimum.z && pz[lane] <= terrain.Bounds.maximum.z) {
+                    state[lane] = eSampleRaycast;
+                }
+            }
+            return;
+        }
+
+        // sample coordinates: rows along the heightfield's x axis, columns along its z axis
+        alignas(16) float fx[PACKET_SIZE];
+        alignas(16) float fz[PACKET_SIZE];
+#ifdef TERRAIN_SAMPLER_SSE
+        __m128 dx = _mm_sub_ps(_mm_load_ps(px), _mm_set1_ps(terrain.Origin[0]));
+        __m128 dz = _mm_sub_ps(_mm_load_ps(pz), _mm_set1_ps(terrain.Origin[2]));
+        __m128 lx = _mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(terrain.AxisX[0])), _mm_mul_ps(dz, _mm_set1_ps(terrain.AxisX[1])));
+        __m128 lz = _mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(terrain.AxisZ[0])), _mm_mul_ps(dz, _mm_set1_ps(terrain.AxisZ[1])));
+        _mm_store_ps(fx, _mm_div_ps(lx, _mm_set1_ps(terrain.RowScale)));
+        _mm_store_ps(fz, _mm_div_ps(lz, _mm_set1_ps(terrain.ColumnScale)));
+#else
+        for (int lane = 0; lane < PACKET_SIZE; lane++) {
+            float dx = px[lane] - terrain.Origin[0];
+            float dz = pz[lane] - terrain.Origin[2];
+            fx[lane] = (dx * terrain.AxisX[0] + dz * terrain.AxisX[1]) / terrain.RowScale;
+            fz[lane] = (dx * terrain.AxisZ[0] + dz * terrain.AxisZ[1]) / terrain.ColumnScale;
+        }
+#endif
+
+        CellPacket cells;
+        memset(&cells, 0, sizeof(cells));
+        unsigned inside = 0;
+        float maxRow = float(terrain.Rows - 1);
+        float maxCol = float(terrain.Columns - 1);
+        for (unsigned lane = 0; lane < count; lane++) {
+            if (!(fx[lane] >= 0.0f && fx[lane] <= maxRow && fz[lane] >= 0.0f && fz[lane] <= maxCol)) {
+                continue;
+            }
+            unsigned row = std::min(unsigned(fx[lane]), terrain.Rows - 2);
+            unsigned col = std::min(unsigned(fz[lane]), terrain.Columns - 2);
+            uint8_t flags = terrain.Cells[row * (terrain.Columns - 1) + col];
+            if (flags & (eCellHole | eCellCovered)) {
+                state[lane] = eSampleRaycast;
+                continue;
+            }
+            const float *h = &terrain.Heights[row * terrain.Columns + col];
+            cells.H00[lane] = h[0];
+            cells.H01[lane] = h[1];
+            cells.H10[lane] = h[terrain.Columns];
+            cells.H11[lane] = h[terrain.Columns + 1];
+            cells.FracX[lane] = fx[lane] - float(row);
+            cells.FracZ[lane] = fz[lane] - float(col);
+            cells.Shared[lane] = (flags & eCellShared) ? 1.0f : 0.0f;
+            inside |= 1u << lane;
+        }
+        if (inside == 0) {
+            return;
+        }
+
+        float local[PACKET_SIZE];
+        interpolate(cells, local);
+        for (unsigned lane = 0; lane < count; lane++) {
+            if ((inside & (1u << lane)) == 0 || state[lane] == eSampleRaycast) {
+                continue;
+            }
+            float height = terrain.Origin[1] + local[lane] * terrain.HeightScale;
+            if (state[lane] == eSampleMiss || height > heights[lane]) {
+                heights[lane] = height;
+            }
+            state[lane] = eSampleHit;
+        }
+    }
+
+    uint64_t TerrainSampler::GetBytes() const {
+        uint64_t bytes = mTerrains.capacity() * sizeof(Terrain);
+        for (size_t i = 0; i < mTerrains.size(); i++)
+        {
+            bytes += mTerrains[i].Heights.capacity() * sizeof(float);
+            bytes += mTerrains[i].Cells.capacity();
+        }
+        return bytes;
+    }
+
+}
@@ -0,0 +1,68 @@
+#ifndef __TERRAIN_SAMPLER_H__
+#define __TERRAIN_SAMPLER_H__
+
+#include <geometry/PxHeightFieldGeometry.h>
+#include <foundation/PxTransform.h>
+#include <foundation/PxBounds3.h>
+#include <vector>
+#include "../PhysxWrap.h"
+
+namespace PhysxWrap {
+
+    // ground height under points of the horizontal plane, read straight from copies of the heightfield samples.
+    // Interpolates over the same triangles PhysX collides against, 4 points at a time.
+    // Const once built: any thread may Sample without a scene or a lock.
+    class TerrainSampler
+    {
+    public:
+        enum SampleState : uint8_t {
+            eSampleMiss = 0,        // no terrain under the point
+            eSampleHit = 1,         // heights[i] is the ground
+            eSampleRaycast = 2,     // over a covered cell, a hole or a tilted terrain: the caller raycasts
+        };
+
+        TerrainSampler();
+
+        void Clear();
+        // the terrain is copied; one tilted off the vertical axis only routes the points above it to raycasts
+        void AddTerrain(const physx::PxHeightFieldGeometry &geom, const physx::PxTransform &pose);
+        // other ground may lie above the cells under `bounds`: points there are left to raycasts
+        void MarkCovered(const physx::PxBounds3 &bounds);
+        inline bool Empty() const { return mTerrains.empty(); }
+
+        // xz: x,z pairs. The highest terrain under each point wins
+        void Sample(const float *xz, unsigned count, float *heights, uint8_t *state) const;
+
+        uint64_t GetBytes() const;
+
+    private:
+        enum {
+            eCellShared = 1,    // split along the diagonal through the first sample (PhysX tess flag)
+            eCellHole = 2,
+            eCellCovered = 4,
+        };
+
+        struct Terrain {
+            float Origin[3];
+            float AxisX[2];     // world x,z of the heightfield row axis
+            float AxisZ[2];     // world x,z of the column axis
+            float RowScale;
+            float ColumnScale;
+            float HeightScale;
+            unsigned Rows;
+            unsigned Columns;
+            bool Tilted;
+            physx::PxBounds3 Bounds;
+            std::vector<float> Heights;     // Rows x Columns, unscaled
+            std::vector<uint8_t> Cells;     // (Rows - 1) x (Columns - 1) eCell flags
+        };
+
+        // one packet: px/pz hold 4 points (aligned), the first `count` of them used
+        static void samplePacket(const Terrain &terrain, const float *px, const float *pz, unsigned count, float *heights, uint8_t *state);
+
+        std::vector<Terrain> mTerrains;
+    };
+
+};
+
+#endif
@@ -0,0 +1,372 @@
+#include "transform_codec.h"
+#include "util.h"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define STATE_MAGIC (0x534E5254)    // "TRNS"
+#define PACKET_MAGIC (0x544C4454)   // "TDLT"
+#define MAX_POSITION_BITS (24)      // float mantissa
+#define ROTATION_BITS (10)
+#define ROTATION_MAX ((1 << ROTATION_BITS) - 1)
+#define ROTATION_STEPS (ROTATION_MAX - 1)   // even, so 0 is exact
+#define SQRT_HALF (0.70710678f)
+
+namespace PhysxWrap {
+
+    struct PacketHeader {
+        uint32_t Magic;
+        uint32_t Count;
+        uint64_t BaselineHash;      // HashBytes of the baseline state, 0 for none
+        float Min[3];
+        float Max[3];
+        uint32_t PositionBits;
+    };
+
+    enum {
+        eRecordNew = 1,
+        eRecordRemoved = 2,
+        eRecordPosition = 4,
+        eRecordRotation = 8,
+    };
+
+    static void writeVarint(std::vector<uint8_t> &out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    static bool readVarint(const uint8_t* &p, const uint8_t *end, uint64_t &value) {
+        value = 0;
+        for (unsigned shift = 0; shift < 64 && p < end; shift += 7) {
+            uint8_t byte = *p++;
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void writeUint32(std::vector<uint8_t> &out, uint32_t value) {
+        uint8_t bytes[sizeof(value)];
+        memcpy(bytes, &value, sizeof(value));
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+    }
+
+    static bool readUint32(const uint8_t* &p, const uint8_t *end, uint32_t &value) {
+        if (end - p < ptrdiff_t(sizeof(value))) {
+            return false;
+        }
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return true;
+    }
+
+    static uint64_t zigzag(int64_t v) {
+        return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t v) {
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+
+    // largest component dropped (and made positive), the other three in 10 bits each over [-1/sqrt2, 1/sqrt2]
+    uint32_t TransformCodec::packRotation(const physx::PxQuat &rotation) {
+        physx::PxQuat q = rotation.getNormalized();
+        float c[4] = { q.x, q.y, q.z, q.w };
+        unsigned largest = 0;
+        for (unsigned i = 1; i < 4; i++) {
+            if (std::fabs(c[i]) > std::fabs(c[largest])) {
+                largest = i;
+            }
+        }
+        float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+        uint32_t packed = largest;
+        for (unsigned i = 0; i < 4; i++) {
+            if (i == largest) {
+                continue;
+            }
+            float v = (c[i] * sign / SQRT_HALF + 1.0f) * 0.5f;
+            int quantized = int(std::floor(v * ROTATION_STEPS + 0.5f));
+            packed = (packed << ROTATION_BITS) | uint32_t(std::min(std::max(quantized, 0), ROTATION_STEPS));
+        }
+        return packed;
+    }
+
+    physx::PxQuat TransformCodec::unpackRotation(uint32_t packed) {
+        unsigned largest = packed >> (3 * ROTATION_BITS);
+        float c[4];
+        float sumSq = 0.0f;
+        for (int i = 3; i >= 0; i--) {
+            if (unsigned(i) == largest) {
+                continue;
+            }
+            float v = float(packed & ROTATION_MAX) / ROTATION_STEPS;
+            packed >>= ROTATION_BITS;
+            c[i] = (v * 2.0f - 1.0f) * SQRT_HALF;
+            sumSq += c[i] * c[i];
+        }
+        c[largest] = std::sqrt(std::max(1.0f - sumSq, 0.0f));
+        return physx::PxQuat(c[0], c[1], c[2], c[3]).getNormalized();
+    }
+
+    void TransformCodec::Quantize(const physx::PxBounds3 &bounds, unsigned positionBits, std::vector<Pose> &poses, std::vector<uint8_t> &state) {
+        positionBits = std::min(std::max(positionBits, 1u), unsigned(MAX_POSITION_BITS));
+        std::sort(poses.begin(), poses.end(), [](const Pose &a, const Pose &b) { return a.Id < b.Id; });
+        state.resize(sizeof(StateHeader) + poses.size() * sizeof(QuantizedPose));
+        auto header = (StateHeader*)state.data();
+        header->Magic = STATE_MAGIC;
+        header->Count = uint32_t(poses.size());
+        header->PositionBits = positionBits;
+        header->Reserved = 0;
+        float steps = float((1u << positionBits) - 1);
+        float scale[3];
+        for (int axis = 0; axis < 3; axis++) {
+            header->Min[axis] = bounds.minimum[axis];
+            header->Max[axis] = bounds.maximum[axis];
+            float extent = bounds.maximum[axis] - bounds.minimum[axis];
+            scale[axis] = extent > 0.0f ? steps / extent : 0.0f;
+        }
+        auto quantized = (QuantizedPose*)(state.data() + sizeof(StateHeader));
+        for (size_t i = 0; i < poses.size(); i++, quantized++) {
+            quantized->Id = poses[i].Id;
+            for (int axis = 0; axis < 3; axis++) {
+                float v = (poses[i].Transform.p[axis] - bounds.minimum[axis]) * scale[axis];
+                // out of bounds positions are clamped to the border
+                v = std::min(std::max(v, 0.0f), steps);
+                quantized->Position[axis] = uint32_t(v + 0.5f);
+            }
+            quantized->Rotation = packRotation(poses[i].Transform.q);
+        }
+    }
+
+    bool TransformCodec::readState(const std::vector<uint8_t> &state, const StateHeader* &header, const QuantizedPose* &poses) {
+        if (state.size() < sizeof(StateHeader)) {
+            return false;
+        }
+        header = (const StateHeader*)state.data();
+        if (header->Magic != STATE_MAGIC || header->PositionBits == 0 || header->PositionBits > MAX_POSITION_BITS
+            || state.size() != sizeof(StateHeader) + header->Count * sizeof(QuantizedPose)) {
+            return false;
+        }
+        poses = (const QuantizedPose*)(state.data() + sizeof(StateHeader));
+        return true;
+    }
+
+    bool TransformCodec::Dequantize(const std::vector<uint8_t> &state, std::vector<Pose> &poses) {
+        const StateHeader *header;
+        const QuantizedPose *quantized;
+        if (!readState(state, header, quantized)) {
+            ERROR("[physx] read transform state fail. bad buffer");
+            return false;
+        }
+        float steps = float((1u << header->PositionBits) - 1);
+        poses.resize(header->Count);
+        for (uint32_t i = 0; i < header->Count; i++) {
+            poses[i].Id = quantized[i].Id;
+            for (int axis = 0; axis < 3; axis++) {
+                poses[i].Transform.p[axis] = header->Min[axis] + (header->Max[axis] - header->Min[axis]) * (float(quantized[i].Position[axis]) / steps);
+            }
+            poses[i].Transform.q = unpackRotation(quantized[i].Rotation);
+        }
+        return true;
+    }
+
+    bool TransformCodec::EncodeDelta(const std::vector<uint8_t> &baseline, const std::vector<uint8_t> &state, std::vector<uint8_t> &packet) {
+        const StateHeader *header;
+        const QuantizedPose *current;
+        if (!readState(state, header, current)) {
+            ERROR("[physx] encode transform delta fail. bad state");
+            return false;
+        }
+        const StateHeader *baseHeader = nullptr;
+        const QuantizedPose *base = nullptr;
+        uint32_t baseCount = 0;
+        if (!baseline.empty()) {
+            if (!readState(baseline, baseHeader, base)) {
+                ERROR("[physx] encode transform delta fail. bad baseline");
+                return false;
+            }
+            if (memcmp(baseHeader->Min, header->Min, sizeof(header->Min)) != 0 || memcmp(baseHeader->Max, header->Max, sizeof(header->Max)) != 0
+                || baseHeader->PositionBits != header->PositionBits) {
+                ERROR("[physx] encode transform delta fail. baseline quantized differently");
+                return false;
+            }
+            baseCount = baseHeader->Count;
+        }
+
+        packet.resize(sizeof(PacketHeader));
+        uint32_t records = 0;
+        uint64_t prevId = 0;
+        uint32_t i = 0, j = 0;
+        while (i < header->Count || j < baseCount) {
+            uint64_t id;
+            uint8_t flags = 0;
+            const QuantizedPose *cur = nullptr;
+            const QuantizedPose *old = nullptr;
+            if (j >= baseCount || (i < header->Count && current[i].Id < base[j].Id)) {
+                cur = &current[i++];
+                id = cur->Id;
+                flags = eRecordNew;
+            }
+            else if (i >= header->Count || base[j].Id < current[i].Id) {
+                id = base[j++].Id;
+                flags = eRecordRemoved;
+            }
+            else {
+                cur = &current[i++];
+                old = &base[j++];
+                id = cur->Id;
+                if (memcmp(cur->Position, old->Position, sizeof(cur->Position)) != 0) {
+                    flags |= eRecordPosition;
+                }
+                if (cur->Rotation != old->Rotation) {
+                    flags |= eRecordRotation;
+                }
+                if (flags == 0) {
+                    // unchanged since the baseline
+                    continue;
+                }
+            }
+            writeVarint(packet, id - prevId);
+            prevId = id;
+            packet.push_back(flags);
+            if (flags & eRecordNew) {
+                for (int axis = 0; axis < 3; axis++) {
+                    writeVarint(packet, cur->Position[axis]);
+                }
+                writeUint32(packet, cur->Rotation);
+            }
+            if (flags & eRecordPosition) {
+                for (int axis = 0; axis < 3; axis++) {
+                    writeVarint(packet, zigzag(int64_t(cur->Position[axis]) - int64_t(old->Position[axis])));
+                }
+            }
+            if (flags & eRecordRotation) {
+                writeUint32(packet, cur->Rotation);
+            }
+            records++;
+        }
+
+        auto packetHeader = (PacketHeader*)packet.data();
+        packetHeader->Magic = PACKET_MAGIC;
+        packetHeader->Count = records;
+        packetHeader->BaselineHash = baseline.empty() ? 0 : HashBytes(baseline.data(), baseline.size());
+        memcpy(packetHeader->Min, header->Min, sizeof(header->Min));
+        memcpy(packetHeader->Max, header->Max, sizeof(header->Max));
+        packetHeader->PositionBits = header->PositionBits;
+        return true;
+    }
+
+    bool TransformCodec::DecodeDelta(const std::vector<uint8_t> &baseline, const std::vector<uint8_t> &packet, std::vector<uint8_t> &state) {
+        if (packet.size() < sizeof(PacketHeader)) {
+            ERROR("[physx] decode transform delta fail. packet too small");
+            return false;
+        }
+        PacketHeader packetHeader;
+        memcpy(&packetHeader, packet.data(), sizeof(packetHeader));
+        if (packetHeader.Magic != PACKET_MAGIC || packetHeader.PositionBits == 0 || packetHeader.PositionBits > MAX_POSITION_BITS) {
+            ERROR("[physx] decode transform delta fail. bad header");
+            return false;
+        }
+        uint64_t baselineHash = baseline.empty() ? 0 : HashBytes(baseline.data(), baseline.size());
+        if (packetHeader.BaselineHash != baselineHash) {
+            ERROR("[physx] decode transform delta fail. packet was encoded against another baseline");
+            return false;
+        }
+        const StateHeader *baseHeader = nullptr;
+        const QuantizedPose *base = nullptr;
+        uint32_t baseCount = 0;
+        if (!baseline.empty()) {
+            if (!readState(baseline, baseHeader, base)) {
+                ERROR("[physx] decode transform delta fail. bad baseline");
+                return false;
+            }
+            baseCount = baseHeader->Count;
+        }
+
+        std::vector<QuantizedPose> result;
+        result.reserve(baseCount + packetHeader.Count);
+        const uint8_t *p = packet.data() + sizeof(PacketHeader);
+        const uint8_t *end = packet.data() + packet.size();
+        uint64_t id = 0;
+        uint32_t j = 0;
+        for (uint32_t i = 0; i < packetHeader.Count; i++) {
+            uint64_t idDelta;
+            if (!readVarint(p, end, idDelta) || p >= end) {
+                ERROR("[physx] decode transform delta fail. truncated packet");
+                return false;
+            }
+            id += idDelta;
+            uint8_t flags = *p++;
+            // baseline actors before this record did not change
+            while (j < baseCount && base[j].Id < id) {
+                result.push_back(base[j++]);
+            }
+            bool inBaseline = j < baseCount && base[j].Id == id;
+            if ((flags & eRecordNew) ? inBaseline : !inBaseline) {
+                ERROR("[physx] decode transform delta fail. record does not match the baseline");
+                return false;
+            }
+            if (flags & eRecordRemoved) {
+                j++;
+                continue;
+            }
+            QuantizedPose pose;
+            if (flags & eRecordNew) {
+                pose.Id = id;
+                for (int axis = 0; axis < 3; axis++) {
+                    uint64_t v;
+                    if (!readVarint(p, end, v)) {
+                        ERROR("[physx] decode transform delta fail. truncated packet");
+                        return false;
+                    }
+                    pose.Position[axis] = uint32_t(v);
+                }
+                if (!readUint32(p, end, pose.Rotation)) {
+                    ERROR("[physx] decode transform delta fail. truncated packet");
+                    return false;
+                }
+            }
+            else {
+                pose = base[j++];
+            }
+            if (flags & eRecordPosition) {
+                for (int axis = 0; axis < 3; axis++) {
+                    uint64_t v;
+                    if (!readVarint(p, end, v)) {
+                        ERROR("[physx] decode transform delta fail. truncated packet");
+                        return false;
+                    }
+                    pose.Position[axis] = uint32_t(int64_t(pose.Position[axis]) + unzigzag(v));
+                }
+            }
+            if ((flags & eRecordRotation) && !readUint32(p, end, pose.Rotation)) {
+                ERROR("[physx] decode transform delta fail. truncated packet");
+                return false;
+            }
+            result.push_back(pose);
+        }
+        while (j < baseCount) {
+            result.push_back(base[j++]);
+        }
+
+        state.resize(sizeof(StateHeader) + result.size() * sizeof(QuantizedPose));
+        auto header = (StateHeader*)state.data();
+        header->Magic = STATE_MAGIC;
+        header->Count = uint32_t(result.size());
+        memcpy(header->Min, packetHeader.Min, sizeof(header->Min));
+        memcpy(header->Max, packetHeader.Max, sizeof(header->Max));
+        header->PositionBits = packetHeader.PositionBits;
+        header->Reserved = 0;
+        if (!result.empty()) {
+            memcpy(state.data() + sizeof(StateHeader), result.data(), result.size() * sizeof(QuantizedPose));
+        }
+        return true;
+    }
+
+}
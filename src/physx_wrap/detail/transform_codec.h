@@ -0,0 +1,53 @@
+#ifndef __TRANSFORM_CODEC_H__
+#define __TRANSFORM_CODEC_H__
+
+#include <foundation/PxTransform.h>
+#include <foundation/PxBounds3.h>
+#include <vector>
+#include "../PhysxWrap.h"
+
+namespace PhysxWrap {
+
+    // network encoding of actor transforms.
+    // A state is the full quantized pose list: positions in PositionBits per axis within the header bounds,
+    // rotations smallest-three packed into 32 bits, sorted by id.
+    // A delta packet lists only the actors that differ from a baseline state, with varint position deltas.
+    class TransformCodec
+    {
+    public:
+        struct Pose {
+            uint64_t Id;
+            physx::PxTransform Transform;
+        };
+
+        static void Quantize(const physx::PxBounds3 &bounds, unsigned positionBits, std::vector<Pose> &poses, std::vector<uint8_t> &state);
+        static bool Dequantize(const std::vector<uint8_t> &state, std::vector<Pose> &poses);
+
+        // an empty baseline encodes every actor as new
+        static bool EncodeDelta(const std::vector<uint8_t> &baseline, const std::vector<uint8_t> &state, std::vector<uint8_t> &packet);
+        static bool DecodeDelta(const std::vector<uint8_t> &baseline, const std::vector<uint8_t> &packet, std::vector<uint8_t> &state);
+
+    private:
+        struct StateHeader {
+            uint32_t Magic;
+            uint32_t Count;
+            float Min[3];
+            float Max[3];
+            uint32_t PositionBits;
+            uint32_t Reserved;  // keeps the poses 8-byte aligned
+        };
+
+        struct QuantizedPose {
+            uint64_t Id;
+            uint32_t Position[3];
+            uint32_t Rotation;
+        };
+
+        static uint32_t packRotation(const physx::PxQuat &q);
+        static physx::PxQuat unpackRotation(uint32_t packed);
+        static bool readState(const std::vector<uint8_t> &state, const StateHeader* &header, const QuantizedPose* &poses);
+    };
+
+};
+
+#endif
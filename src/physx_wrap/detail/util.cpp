@@ -40,4 +40,17 @@ namespace PhysxWrap {
         return std::move(ret);
     }
 
+
+    uint64_t HashBytes(const void *data, size_t size, uint64_t seed)
+    {
+        uint64_t hash = seed;
+        const unsigned char *p = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
 }
@@ -2,10 +2,13 @@
 #define __UTIL_H__
 
 #include <string>
+#include <cstdint>
+#include <cstddef>
 
 namespace PhysxWrap {
     unsigned long GetTimeStamp(void);
     std::string GetFileContent(const std::string &filename);
+    uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ULL); // FNV-1a
 };
 
 #endif
@@ -0,0 +1,61 @@
+#include <PhysxWrap.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "PhysxWrap.lib")
+#endif
+
+// replay <log> [threads] [repeat]
+// re-runs a StartRecording log with enhanced determinism and prints the Update cost;
+// the state hash must be the same for every run and every thread count
+int main(int argn, char *argv[]) {
+    if (argn < 2) {
+        printf("usage: %s <log> [threads] [repeat]\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    unsigned threads = argn > 2 ? unsigned(atoi(argv[2])) : 0;
+    int repeat = argn > 3 ? std::max(atoi(argv[3]), 1) : 1;
+
+    if (!PhysxWrap::InitPhysxSDK()) {
+        printf("init physx sdk fail\n");
+        return 1;
+    }
+
+    int ret = 0;
+    uint64_t firstHash = 0;
+    for (int run = 0; run < repeat; run++) {
+        std::vector<float> updateMs;
+        uint64_t stateHash = 0;
+        if (!PhysxWrap::ReplayRecording(path, threads, updateMs, stateHash)) {
+            printf("replay %s fail\n", path);
+            ret = 1;
+            break;
+        }
+
+        float total = 0.0f;
+        for (auto ms : updateMs) {
+            total += ms;
+        }
+        std::sort(updateMs.begin(), updateMs.end());
+        auto percentile = [&updateMs](float p) {
+            return updateMs.empty() ? 0.0f : updateMs[size_t(p * (updateMs.size() - 1))];
+        };
+        printf("run %d threads %u: updates %u, total %.2f ms, avg %.3f ms, p50 %.3f ms, p95 %.3f ms, max %.3f ms, hash %016llx\n",
+            run, threads, unsigned(updateMs.size()), total, updateMs.empty() ? 0.0f : total / updateMs.size(),
+            percentile(0.5f), percentile(0.95f), updateMs.empty() ? 0.0f : updateMs.back(), (unsigned long long)stateHash);
+
+        if (run == 0) {
+            firstHash = stateHash;
+        } else if (stateHash != firstHash) {
+            printf("run %d diverged from run 0\n", run);
+            ret = 2;
+        }
+    }
+
+    PhysxWrap::ReleasePhysxSDK();
+    return ret;
+}
@@ -10,6 +10,12 @@
 void Test1();
 void Test2();
 void Test3();
+void Test4();
+void Test5();
+void Test6();
+void Test7();
+void Test8();
+void Test9();
 
 int main(int argn, char *argv[]) {
 
@@ -26,6 +32,12 @@ int main(int argn, char *argv[]) {
     //Test1();
     Test2();
     //Test3();
+    //Test4();
+    //Test5();
+    //Test6();
+    //Test7();
+    //Test8();
+    //Test9();
 
 #ifdef _DEBUG
     Profiler::HeapProfilerDump("exit");
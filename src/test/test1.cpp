@@ -29,6 +29,7 @@ void Test1() {
     test(scene, "../../res/pxscene");
 
     auto &s = scene;
+    s.SetFixedTimestep(1.0f / 60, 4);
     auto actor = s.CreateSphereDynamic(Vector3{ 10, 25, 10 }, 25);
     s.SetLinearVelocity(actor, Vector3{ 0, 0, 1 });
 
@@ -49,7 +50,7 @@ void Test1() {
         std::cout << "nowTime - pretTime = " << dt << std::endl;
 
         s.Update(dt);
-        Vector3 pos = s.GetGlobalPostion(actor);
+        Vector3 pos = s.GetInterpolatedPostion(actor);
         std::cout << "(x, y, z) = (" << pos.X << "," << pos.Y << "," << pos.Z << ")" << std::endl;
     }
     ReleasePhysxSDK();
@@ -0,0 +1,92 @@
+#include <PhysxWrap.h>
+#include <string>
+#include <iostream>
+#include "util.h"
+#include <random>
+#include <time.h>
+
+using namespace PhysxWrap;
+
+// mesh cooking parameters: memory, raycast and contact cost on the sample map
+
+#define SCENE_PATH "../../res/pxscene"
+#define RAYCAST_COUNT (100000)
+#define SPHERE_COUNT (1000)
+#define STEP_COUNT (300)
+
+static void bench(const char *name, const MeshCookingConfig &config) {
+    SetMeshCookingConfig(config);
+    UnloadSceneInfo(SCENE_PATH);
+
+    auto t1 = GetTimeStamp();
+    PhysxScene scene;
+    scene.Init();
+    scene.CreateScene(SCENE_PATH);
+    auto t2 = GetTimeStamp();
+
+    srand(1);
+    RaycastHit hit;
+    unsigned hits = 0;
+    for (size_t i = 0; i < RAYCAST_COUNT; i++)
+    {
+        float x = float(rand() % 1000);
+        float z = float(rand() % 1000);
+        if (scene.Raycast(Vector3{ x, 500, z }, Vector3{ 0, -1, 0 }, 1000, hit)) {
+            hits++;
+        }
+    }
+    auto t3 = GetTimeStamp();
+
+    for (size_t i = 0; i < SPHERE_COUNT; i++)
+    {
+        float x = float(rand() % 1000);
+        float y = float(rand() % 50 + 10);
+        float z = float(rand() % 1000);
+        scene.CreateSphereDynamic(Vector3{ x, y, z }, 0.5f);
+    }
+    for (size_t i = 0; i < STEP_COUNT; i++)
+    {
+        scene.Update(0.016f);
+    }
+    auto t4 = GetTimeStamp();
+
+    std::cout << name
+        << "\tmesh bytes: " << GetRegisteredMeshBytes()
+        << "\tload: " << (t2 - t1) << "ms"
+        << "\traycast: " << (t3 - t2) << "ms (" << hits << " hits)"
+        << "\tcontact: " << (t4 - t3) << "ms"
+        << std::endl;
+}
+
+void Test4() {
+    InitPhysxSDK();
+
+    MeshCookingConfig config;
+    bench("bvh33 default", config);
+
+    config.SizePerformanceTradeOff = 0.0f;
+    bench("bvh33 smallest", config);
+
+    config.SizePerformanceTradeOff = 1.0f;
+    bench("bvh33 fastest", config);
+
+    config = MeshCookingConfig();
+    config.CookingHint = eHintCookingPerformance;
+    bench("bvh33 fast cooking", config);
+
+    config = MeshCookingConfig();
+    config.Midphase = eMidphaseBVH34;
+    bench("bvh34 4 tris/leaf", config);
+
+    config.TrisPerLeaf = 15;
+    bench("bvh34 15 tris/leaf", config);
+
+    config.TrisPerLeaf = 4;
+    config.SuppressRemapTable = true;
+    config.DisableActiveEdges = true;
+    bench("bvh34 no remap/active edges", config);
+
+    UnloadSceneInfo(SCENE_PATH);
+    ReleasePhysxSDK();
+    std::cout << "exit Test4" << std::endl;
+}
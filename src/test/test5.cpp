@@ -0,0 +1,67 @@
+#include <PhysxWrap.h>
+#include <string>
+#include <iostream>
+#include "util.h"
+#include <random>
+#include <time.h>
+
+using namespace PhysxWrap;
+
+// broadphase: SAP vs MBP on the sample map with many spread-out dynamics
+
+#define SCENE_PATH "../../res/pxscene"
+#define DYNAMIC_COUNT (5000)
+#define STEP_COUNT (300)
+
+static void bench(const char *name, const SceneConfig &config) {
+    auto t1 = GetTimeStamp();
+    PhysxScene scene;
+    scene.Init(config);
+    scene.CreateScene(SCENE_PATH);
+
+    srand(1);
+    for (size_t i = 0; i < DYNAMIC_COUNT; i++)
+    {
+        float x = float(rand() % 1000);
+        float y = float(rand() % 50 + 10);
+        float z = float(rand() % 1000);
+        if (i % 2 == 0) {
+            scene.CreateSphereDynamic(Vector3{ x, y, z }, 0.5f);
+        }
+        else {
+            scene.CreateBoxDynamic(Vector3{ x, y, z }, Vector3{ 0.5f, 0.5f, 0.5f });
+        }
+    }
+    auto t2 = GetTimeStamp();
+
+    for (size_t i = 0; i < STEP_COUNT; i++)
+    {
+        scene.Update(0.016f);
+    }
+    auto t3 = GetTimeStamp();
+
+    std::cout << name
+        << "\tcreate: " << (t2 - t1) << "ms"
+        << "\tsimulate: " << (t3 - t2) << "ms (" << float(t3 - t2) / STEP_COUNT << "ms/step)"
+        << std::endl;
+}
+
+void Test5() {
+    InitPhysxSDK();
+
+    SceneConfig config;
+    bench("sap", config);
+
+    config.BroadPhase = eBroadPhaseMBP;
+    config.RegionSubdivisions = 4;
+    bench("mbp 4x4", config);
+
+    config.RegionSubdivisions = 8;
+    bench("mbp 8x8", config);
+
+    config.RegionSubdivisions = 16;
+    bench("mbp 16x16", config);
+
+    ReleasePhysxSDK();
+    std::cout << "exit Test5" << std::endl;
+}
@@ -0,0 +1,80 @@
+#include <PhysxWrap.h>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include "util.h"
+
+using namespace PhysxWrap;
+
+// transform codec: capture -> delta -> decode round trip with actors moved, rotated past the quaternion sign, removed and added
+
+#define WORLD_EXTENT (1000.0f)
+#define POSITION_BITS (18)
+#define BOX_COUNT (8)
+
+static bool samePose(PhysxScene &scene, uint64_t id, const Vector3 &pos, const Quat &rotate) {
+    // half a quantization step per axis, one step of slack
+    float tolerance = 2.0f * WORLD_EXTENT / float(1 << POSITION_BITS);
+    Vector3 live = scene.GetGlobalPostion(id);
+    Quat q = scene.GetGlobalRotate(id);
+    float dot = q.X * rotate.X + q.Y * rotate.Y + q.Z * rotate.Z + q.W * rotate.W;
+    return std::fabs(live.X - pos.X) <= tolerance && std::fabs(live.Y - pos.Y) <= tolerance && std::fabs(live.Z - pos.Z) <= tolerance
+        && std::fabs(dot) > 0.999f;
+}
+
+void Test6() {
+    InitPhysxSDK();
+
+    SceneConfig config;
+    config.WorldMin = Vector3{ -WORLD_EXTENT, -WORLD_EXTENT, -WORLD_EXTENT };
+    config.WorldMax = Vector3{ WORLD_EXTENT, WORLD_EXTENT, WORLD_EXTENT };
+    {
+        PhysxScene scene;
+        scene.Init(config);
+        std::vector<uint64_t> boxes;
+        for (int i = 0; i < BOX_COUNT; i++)
+        {
+            boxes.push_back(scene.CreateBoxDynamic(Vector3{ i * 10.0f - 35.0f, 5.0f, 0.0f }, Vector3{ 0.5f, 0.5f, 0.5f }));
+        }
+        std::vector<uint8_t> baseline;
+        scene.CaptureTransforms(baseline, POSITION_BITS);
+
+        // w < 0: the codec may send -q, the same rotation
+        float n = std::sqrt(0.1f * 0.1f * 2 + 0.7f * 0.7f * 2);
+        scene.SetGlobalRotate(boxes[1], Quat{ 0.1f / n, 0.7f / n, -0.1f / n, -0.7f / n });
+        scene.SetGlobalPostion(boxes[2], Vector3{ 123.456f, 7.5f, -321.5f });
+        // added first: ids are addresses, the removed box's could be reused
+        uint64_t added = scene.CreateSphereDynamic(Vector3{ -500.0f, 20.0f, 500.0f }, 1.0f);
+        scene.RemoveActor(boxes[3]);
+        std::vector<uint8_t> state;
+        scene.CaptureTransforms(state, POSITION_BITS);
+
+        std::vector<uint8_t> packet;
+        std::vector<uint8_t> decoded;
+        Check(EncodeTransformDelta(baseline, state, packet), "encode delta");
+        Check(DecodeTransformDelta(baseline, packet, decoded), "decode delta");
+        Check(decoded == state, "delta decodes to the captured state");
+
+        std::vector<uint8_t> full;
+        Check(EncodeTransformDelta(std::vector<uint8_t>(), state, packet), "encode full update");
+        Check(DecodeTransformDelta(std::vector<uint8_t>(), packet, full), "decode full update");
+        Check(full == state, "full update decodes to the captured state");
+
+        std::vector<uint64_t> ids;
+        std::vector<Vector3> postions;
+        std::vector<Quat> rotates;
+        Check(ReadTransforms(decoded, ids, postions, rotates), "read transforms");
+        Check(ids.size() == BOX_COUNT, "one removed, one added");
+        Check(std::is_sorted(ids.begin(), ids.end()), "sorted by id");
+        Check(std::find(ids.begin(), ids.end(), boxes[3]) == ids.end(), "removed actor is gone");
+        Check(std::find(ids.begin(), ids.end(), added) != ids.end(), "added actor is present");
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            Check(samePose(scene, ids[i], postions[i], rotates[i]), "pose within quantization");
+        }
+    }
+
+    ReleasePhysxSDK();
+    std::cout << "exit Test6" << std::endl;
+}
@@ -0,0 +1,83 @@
+#include <PhysxWrap.h>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include "util.h"
+
+using namespace PhysxWrap;
+
+// interest grid: queries that straddle cell boundaries (negative coordinates included) against a brute-force scan
+
+#define CELL_SIZE (10.0f)
+#define LATTICE_STEP (2.5f)     // four actors per cell side, one on every cell edge
+#define LATTICE_HALF (16)
+
+static std::vector<uint64_t> bruteForce(PhysxScene &scene, const std::vector<uint64_t> &actors, const Vector3 &observer, float radius) {
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < actors.size(); i++)
+    {
+        Vector3 pos = scene.GetGlobalPostion(actors[i]);
+        float dx = pos.X - observer.X;
+        float dz = pos.Z - observer.Z;
+        if (dx * dx + dz * dz <= radius * radius) {
+            ids.push_back(actors[i]);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+static void query(PhysxScene &scene, const std::vector<uint64_t> &actors, const std::vector<Vector3> &observers, float radius) {
+    std::vector<uint64_t> ids;
+    std::vector<unsigned> offsets;
+    scene.QueryInterest(observers.data(), unsigned(observers.size()), radius, ids, offsets);
+    if (!Check(offsets.size() == observers.size() + 1, "one offset per observer plus the end")) {
+        return;
+    }
+    for (size_t i = 0; i < observers.size(); i++)
+    {
+        std::vector<uint64_t> found(ids.begin() + offsets[i], ids.begin() + offsets[i + 1]);
+        std::sort(found.begin(), found.end());
+        Check(found == bruteForce(scene, actors, observers[i], radius), "grid query equals the brute-force scan");
+    }
+}
+
+void Test7() {
+    InitPhysxSDK();
+    {
+        PhysxScene scene;
+        scene.Init();
+        scene.EnableInterest(CELL_SIZE);
+        std::vector<uint64_t> actors;
+        for (int x = -LATTICE_HALF; x < LATTICE_HALF; x++)
+        {
+            for (int z = -LATTICE_HALF; z < LATTICE_HALF; z++)
+            {
+                actors.push_back(scene.CreateBoxStatic(Vector3{ x * LATTICE_STEP, 0.0f, z * LATTICE_STEP }, Vector3{ 0.5f, 0.5f, 0.5f }));
+            }
+        }
+
+        // on a cell corner, on an edge, just inside a cell, and in the negative quadrant
+        std::vector<Vector3> observers = {
+            Vector3{ 0.0f, 0.0f, 0.0f },
+            Vector3{ 10.0f, 0.0f, -10.0f },
+            Vector3{ 9.99f, 0.0f, 5.0f },
+            Vector3{ -15.0f, 0.0f, -27.5f },
+            Vector3{ -40.0f, 0.0f, 39.0f },
+        };
+        // radii avoid exact lattice distances; the last spans more cells than are occupied
+        query(scene, actors, observers, 7.3f);
+        query(scene, actors, observers, 26.1f);
+        query(scene, actors, observers, 500.0f);
+
+        // moved across cell boundaries, and removed
+        scene.SetGlobalPostion(actors[0], Vector3{ 0.1f, 0.0f, -0.1f });
+        scene.SetGlobalPostion(actors[1], Vector3{ 10.05f, 0.0f, -9.95f });
+        scene.RemoveActor(actors[2]);
+        actors.erase(actors.begin() + 2);
+        query(scene, actors, observers, 7.3f);
+        query(scene, actors, observers, 26.1f);
+    }
+    ReleasePhysxSDK();
+    std::cout << "exit Test7" << std::endl;
+}
@@ -0,0 +1,131 @@
+#include <PhysxWrap.h>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <geometry/PxGeometryQuery.h>
+#include "detail/physx_sdk.h"
+#include "detail/terrain_sampler.h"
+#include "util.h"
+
+using namespace PhysxWrap;
+
+// terrain sampler vs PhysX: heights read from the samples must match a downward PxGeometryQuery::raycast
+// on the same heightfield, with cells split both ways by the tess flag
+
+#define HF_ROWS (33)
+#define HF_COLUMNS (17)
+#define HEIGHT_SCALE (0.01f)
+#define ROW_SCALE (1.5f)
+#define COLUMN_SCALE (2.0f)
+#define POINT_COUNT (1001)      // not a multiple of the 4-point packets
+#define HEIGHT_TOLERANCE (1e-3f)
+
+static physx::PxHeightField* createHeightField() {
+    std::vector<physx::PxHeightFieldSample> samples(HF_ROWS * HF_COLUMNS);
+    srand(1);
+    for (unsigned row = 0; row < HF_ROWS; row++)
+    {
+        for (unsigned col = 0; col < HF_COLUMNS; col++)
+        {
+            auto &sample = samples[row * HF_COLUMNS + col];
+            sample.height = physx::PxI16(rand() % 2000 - 1000);
+            sample.materialIndex0 = 0;
+            sample.materialIndex1 = 0;
+            // checkerboard with a few runs, so both diagonals meet on shared edges
+            if ((row + col) % 2 == 0 || row % 7 == 0) {
+                sample.setTessFlag();
+            }
+        }
+    }
+    physx::PxHeightFieldDesc desc;
+    desc.format = physx::PxHeightFieldFormat::eS16_TM;
+    desc.nbRows = HF_ROWS;
+    desc.nbColumns = HF_COLUMNS;
+    desc.samples.data = samples.data();
+    desc.samples.stride = sizeof(physx::PxHeightFieldSample);
+    std::lock_guard<std::mutex> lock(gPhysxSDKImpl->GetCookingMutex());
+    return gPhysxSDKImpl->GetCooking()->createHeightField(desc, gPhysxSDKImpl->GetPhysics()->getPhysicsInsertionCallback());
+}
+
+void Test8() {
+    InitPhysxSDK();
+
+    physx::PxHeightField* heightField = createHeightField();
+    if (!Check(heightField != nullptr, "create heightfield")) {
+        ReleasePhysxSDK();
+        return;
+    }
+    physx::PxHeightFieldGeometry geom;
+    geom.heightField = heightField;
+    geom.heightScale = HEIGHT_SCALE;
+    geom.rowScale = ROW_SCALE;
+    geom.columnScale = COLUMN_SCALE;
+    physx::PxTransform pose(physx::PxVec3(-30.0f, 2.0f, 15.0f));
+    TerrainSampler sampler;
+    sampler.AddTerrain(geom, pose);
+
+    // random points, cell corners and cell diagonals, and a margin outside the terrain
+    float sizeX = (HF_ROWS - 1) * ROW_SCALE;
+    float sizeZ = (HF_COLUMNS - 1) * COLUMN_SCALE;
+    std::vector<float> xz;
+    for (unsigned i = 0; i < POINT_COUNT; i++)
+    {
+        float u, v;
+        switch (i % 3) {
+        case 0:
+            u = float(rand()) / RAND_MAX * (sizeX + 4.0f) - 2.0f;
+            v = float(rand()) / RAND_MAX * (sizeZ + 4.0f) - 2.0f;
+            break;
+        case 1:
+            u = float(rand() % HF_ROWS) * ROW_SCALE;
+            v = float(rand() % HF_COLUMNS) * COLUMN_SCALE;
+            break;
+        default: {
+            float t = float(rand()) / RAND_MAX;
+            u = (float(rand() % (HF_ROWS - 1)) + t) * ROW_SCALE;
+            v = (float(rand() % (HF_COLUMNS - 1)) + (i % 2 ? t : 1.0f - t)) * COLUMN_SCALE;
+        } break;
+        }
+        xz.push_back(pose.p.x + u);
+        xz.push_back(pose.p.z + v);
+    }
+    std::vector<float> heights(POINT_COUNT);
+    std::vector<uint8_t> state(POINT_COUNT);
+    sampler.Sample(xz.data(), POINT_COUNT, heights.data(), state.data());
+
+    float top = pose.p.y + 1000.0f * HEIGHT_SCALE + 1.0f;
+    unsigned compared = 0;
+    for (unsigned i = 0; i < POINT_COUNT; i++)
+    {
+        float u = xz[i * 2] - pose.p.x;
+        float v = xz[i * 2 + 1] - pose.p.z;
+        bool inside = u >= 0.0f && u <= sizeX && v >= 0.0f && v <= sizeZ;
+        bool onBorder = std::fabs(u) < 1e-4f || std::fabs(v) < 1e-4f || std::fabs(u - sizeX) < 1e-4f || std::fabs(v - sizeZ) < 1e-4f;
+        physx::PxRaycastHit hit;
+        physx::PxU32 hits = physx::PxGeometryQuery::raycast(physx::PxVec3(xz[i * 2], top, xz[i * 2 + 1]), physx::PxVec3(0.0f, -1.0f, 0.0f),
+            geom, pose, 2.0f * top + 20.0f, physx::PxHitFlag::ePOSITION, 1, &hit);
+        if (onBorder) {
+            // the raycast may miss exactly on the outline; the sampler only has to be right when it hits
+            if (hits > 0 && state[i] == TerrainSampler::eSampleHit) {
+                Check(std::fabs(heights[i] - hit.position.y) < HEIGHT_TOLERANCE, "border height matches the raycast");
+            }
+            continue;
+        }
+        if (!inside) {
+            Check(state[i] == TerrainSampler::eSampleMiss, "outside the terrain is a miss");
+            continue;
+        }
+        if (!Check(hits > 0 && state[i] == TerrainSampler::eSampleHit, "inside the terrain is a hit")) {
+            continue;
+        }
+        Check(std::fabs(heights[i] - hit.position.y) < HEIGHT_TOLERANCE, "height matches the raycast");
+        compared++;
+    }
+    std::cout << "compared " << compared << " points" << std::endl;
+
+    heightField->release();
+    ReleasePhysxSDK();
+    std::cout << "exit Test8" << std::endl;
+}
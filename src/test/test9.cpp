@@ -0,0 +1,72 @@
+#include <PhysxWrap.h>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include "util.h"
+
+using namespace PhysxWrap;
+
+// command log replay: the final state hash must not depend on the dispatcher thread count or the run
+
+#define RECORD_PATH "test9.log"
+#define STACK_HEIGHT (6)
+#define STACK_COUNT (4)
+#define UPDATE_COUNT (120)
+
+static bool record() {
+    SceneConfig config;
+    PhysxScene scene;
+    if (!scene.Init(config) || !scene.StartRecording(RECORD_PATH)) {
+        return false;
+    }
+    scene.CreatePlane(0.0f);
+    // stacks that topple into each other, so the contact order matters
+    std::vector<uint64_t> boxes;
+    for (int s = 0; s < STACK_COUNT; s++)
+    {
+        for (int i = 0; i < STACK_HEIGHT; i++)
+        {
+            boxes.push_back(scene.CreateBoxDynamic(Vector3{ s * 1.2f, 0.5f + i * 1.01f, (i % 2) * 0.1f }, Vector3{ 0.5f, 0.5f, 0.5f }));
+        }
+    }
+    uint64_t ball = scene.CreateSphereDynamic(Vector3{ -10.0f, 1.0f, 0.0f }, 0.8f);
+    scene.SetLinearVelocity(ball, Vector3{ 20.0f, 2.0f, 0.3f });
+    for (int i = 0; i < UPDATE_COUNT; i++)
+    {
+        if (i == UPDATE_COUNT / 2) {
+            scene.AddForce(boxes.back(), Vector3{ 0.0f, 200.0f, -50.0f });
+        }
+        scene.Update(1.0f / 60.0f);
+    }
+    scene.StopRecording();
+    return true;
+}
+
+void Test9() {
+    InitPhysxSDK();
+
+    if (Check(record(), "record")) {
+        unsigned threadCounts[] = { 0, 1, 2, 4, 0 };
+        uint64_t firstHash = 0;
+        for (unsigned i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++)
+        {
+            std::vector<float> updateMs;
+            uint64_t stateHash = 0;
+            if (!Check(ReplayRecording(RECORD_PATH, threadCounts[i], updateMs, stateHash), "replay")) {
+                break;
+            }
+            Check(updateMs.size() == UPDATE_COUNT, "one time per recorded Update");
+            std::cout << "threads " << threadCounts[i] << " hash " << std::hex << stateHash << std::dec << std::endl;
+            if (i == 0) {
+                firstHash = stateHash;
+            } else {
+                Check(stateHash == firstHash, "hash equal across thread counts and runs");
+            }
+        }
+    }
+    std::remove(RECORD_PATH);
+
+    ReleasePhysxSDK();
+    std::cout << "exit Test9" << std::endl;
+}
@@ -1,6 +1,7 @@
 #include "util.h"
 #include <string>
 #include <fstream>
+#include <iostream>
 #if defined(_MSC_VER)
 #include <Windows.h>
 #else
@@ -36,3 +37,12 @@ std::string GetFileContent(const std::string &filename)
     in.close();
     return std::move(ret);
 }
+
+bool Check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::cout << "FAIL: " << what << std::endl;
+    }
+    return ok;
+}
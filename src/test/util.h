@@ -5,5 +5,7 @@
 
 unsigned long GetTimeStamp(void);
 std::string GetFileContent(const std::string &filename);
+// prints a FAIL line when ok is false; returns ok
+bool Check(bool ok, const char *what);
 
 #endif
@@ -127,6 +127,8 @@ partial class ServerData
         kMeshCollider = 4,
         kTerrainCollider = 5,
         kSphereCollider = 6,
+        kMesh32 = 7,
+        kTerrainCollider2 = 8,
     }
 
     abstract class PxObject
@@ -297,9 +299,10 @@ partial class ServerData
     class PxMesh : PxObject
     {
         public static readonly PxObjectType clsType = PxObjectType.kMesh;
-        public override PxObjectType type { get { return clsType; } }
+        // meshes whose vertices overflow 16-bit indices are written as kMesh32
+        public override PxObjectType type { get { return vertices.Length > ushort.MaxValue + 1 ? PxObjectType.kMesh32 : clsType; } }
         public Vector3[] vertices;
-        public ushort[] indices;
+        public int[] indices;
 
         public PxMesh(int referenceIndex) { this.referenceIndex = referenceIndex; }
 
@@ -318,21 +321,22 @@ partial class ServerData
                 bw.Write(v.z);
             }
             bw.Write(indices.Length);
+            bool wide = type == PxObjectType.kMesh32;
             for (int i = 0; i < indices.Length; ++i)
             {
-                bw.Write(indices[i]);
+                if (wide)
+                    bw.Write(indices[i]);
+                else
+                    bw.Write((ushort)indices[i]);
             }
         }
 
         public override void dump(Transform root)
         {
             mesh = new Mesh();
+            if (vertices.Length > ushort.MaxValue + 1)
+                mesh.indexFormat = UnityEngine.Rendering.IndexFormat.UInt32;
             mesh.vertices = vertices;
-            var indices = new int[this.indices.Length];
-            for (int i = 0; i < indices.Length; ++i)
-            {
-                indices[i] = this.indices[i];
-            }
             mesh.SetIndices(indices, MeshTopology.Triangles, 0);
         }
     }
@@ -352,14 +356,14 @@ partial class ServerData
                 {
                     indexCount += mesh.GetIndexCount(i);
                 }
-                ret.indices = new ushort[indexCount];
+                ret.indices = new int[indexCount];
                 int index = 0;
                 for (int i = 0; i < mesh.subMeshCount; ++i)
                 {
                     var indices = mesh.GetIndices(i);
                     for (int j = 0; j < indices.Length; ++j)
                     {
-                        ret.indices[index++] = (ushort)indices[j];
+                        ret.indices[index++] = indices[j];
                     }
                 }
                 m_meshes.Add(ret);
@@ -414,18 +418,38 @@ partial class ServerData
 
     class PxTerrainCollider : PxSceneObject
     {
-        public static readonly PxObjectType clsType = PxObjectType.kTerrainCollider;
+        public static readonly PxObjectType clsType = PxObjectType.kTerrainCollider2;
         public override PxObjectType type { get { return clsType; } }
 
+        // cell material index of a hole, see PhysxWrap::eTerrainHole
+        const byte kHole = 127;
+
         public Vector3 size;
         public float[,] heightmap;
+        public PhysicMaterial[] materials;
+        public byte[,] cellMaterials;
 
         public PxTerrainCollider() { }
         public PxTerrainCollider(TerrainCollider source)
         {
             _setPositionAndRotation(source.transform);
-            size = Vector3.Scale(source.terrainData.size, source.transform.lossyScale);
-            heightmap = source.terrainData.GetHeights(0, 0, source.terrainData.heightmapWidth, source.terrainData.heightmapHeight);
+            var td = source.terrainData;
+            size = Vector3.Scale(td.size, source.transform.lossyScale);
+            heightmap = td.GetHeights(0, 0, td.heightmapWidth, td.heightmapHeight);
+            materials = new PhysicMaterial[] { source.sharedMaterial };
+
+            var cells = heightmap.GetLength(0) - 1;
+            cellMaterials = new byte[cells, cells];
+            var holes = td.GetHoles(0, 0, td.holesResolution, td.holesResolution);
+            for (int i = 0; i < cells; ++i)
+            {
+                for (int j = 0; j < cells; ++j)
+                {
+                    // GetHoles returns true where the surface is solid
+                    bool solid = i >= holes.GetLength(0) || j >= holes.GetLength(1) || holes[i, j];
+                    cellMaterials[i, j] = solid ? (byte)0 : kHole;
+                }
+            }
         }
 
         public override void save(BinaryWriter bw)
@@ -443,6 +467,21 @@ partial class ServerData
                     bw.Write(heightmap[i, j]);
                 }
             }
+            bw.Write(materials.Length);
+            for (int i = 0; i < materials.Length; ++i)
+            {
+                var m = materials[i];
+                bw.Write(m != null ? m.staticFriction : 0.6f);
+                bw.Write(m != null ? m.dynamicFriction : 0.6f);
+                bw.Write(m != null ? m.bounciness : 0.0f);
+            }
+            for (int i = 0; i < d - 1; ++i)
+            {
+                for (int j = 0; j < d - 1; ++j)
+                {
+                    bw.Write(cellMaterials[i, j]);
+                }
+            }
         }
     }
 }